@@ -2,6 +2,8 @@
 #include "chessboard_api.h"
 #include "chessboard_0x88.h"
 #include "move_0x88.h"
+#include "movegen_0x88.h"
+#include "san.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
@@ -9,268 +11,152 @@
 
 #include <stdio.h> // For debugging
 
+/*
+Algebraic notation for the 0x88 board.  san_parse works out what the
+text says in one pass, and then we look for the single legal move that
+matches it.  Since the text names the piece that moves, only that
+piece type's pseudo-legal moves are generated, and the make/unmake
+legality test is left for the few that match the text.
+ */
+
 bool chessboard_algmove(chessboard* cb, char* move_str)
 {
-    struct _move move = {};
-    bool valid = cb88_is_alg_move_valid(cb, move_str, &move);
-    if (valid) cb88_move_unchecked(cb, &move);
-    
-    // Handle castling (TODO: Clean this up)
-    if (move.is_castle) _move_rook_castling(cb, &move);
-    if (move.is_king) cb->castle = (struct castle_rights){false};
-    if (move.is_white_kings_rook) cb->castle.white_short = false;
-    if (move.is_white_queens_rook) cb->castle.white_long = false;
-    if (move.is_black_kings_rook) cb->castle.black_short = false;
-    if (move.is_black_queens_rook) cb->castle.black_long = false;
-
-    DEBUG_validate_board(cb);
-    return valid;
+    // Anything after the move itself (like a newline) is ignored.
+    return chessboard_algmove_n(cb, move_str, strcspn(move_str, " \t\r\n"));
 }
 
-// TODO: This has a lot of room for improvement.  At the moment, it's a giant,
-// ugly function with many points of exit.  As with everything else, though,
-// I want to get it working first and then make it pretty.
-//
-// TODO: Also, the move struct isn't cleaned up if we return false.  This is
-// probably fine, but I'd prefer to always give invalid structs obviously
-// invalid properties so that no one uses them by mistake.  
-bool cb88_is_alg_move_valid(chessboard* cb, char* move_str, struct _move* move)
+bool chessboard_algmove_n(chessboard* cb, const char* move_str, size_t len)
 {
-    bool valid = false;
-    chessboard_color color = cb->to_move;
+    struct san_move san;
+    struct move_list moves;
+    struct _move move;
+    struct undo_record undo;
 
-    // TODO: Castling moves could also have extra characters afterwards -
-    // this should check if the strings start with "0-0", etc., instead of
-    // if they equal "0-0".
-    
-    // Castling moves have a special syntax, so we handle them separately.
-    if (!strcmp(move_str, "O-O") || !strcmp(move_str, "o-o") || !strcmp(move_str, "0-0"))
+    bool valid = san_parse(move_str, len, &san);
+    if (valid)
     {
-	switch (color)
-	{
-	case WHITE:
-	    move->from = cb88_get_square(E1);
-	    break;
-	case BLACK:
-	    move->from = cb88_get_square(E8);
-	    break;
-	}
-	move->to = move->from + 2;
-	move->is_castle = true;
-	move->is_king = true;
-	
-	return cb88_is_move_valid(cb, move);
+	cb88_generate_piece_moves(cb, san.piece, &moves);
+	valid = cb88_match_san_move(cb, &san, &moves, &move);
     }
-    else if (!strcmp(move_str, "O-O-O") || !strcmp(move_str, "o-o-o") || !strcmp(move_str, "0-0-0"))
+    if (valid)
     {
-	switch (color)
-	{
-	case WHITE:
-	    move->from = cb88_get_square(E1);
-	    break;
-	case BLACK:
-	    move->from = cb88_get_square(E8);
-	    break;
-	}
-	move->to = move->from - 2;
-	move->is_castle = true;
-	move->is_king = true;
-
-	return cb88_is_move_valid(cb, move);
+	cb88_make_move(cb, &move, &undo);
+	// The API leaves switching the current player to the caller.
+	chessboard_switch_current_player(cb);
     }
 
-    // clean_str will hold the move with all trailing symbols
-    // like '+' and '#' removed.  The longest possible move in
-    // standard algebraic notation is then 6 characters (plus one
-    // for the null character).  For example, Nf3xe5 or dxe8=Q.
-    // The only symbols that should be included are piece types
-    // (K, Q, R, B, N), file and rank names and an x or =.  (Note that 
-    // castling is handled elsewhere.)
-    //
-    // A reasonable user might input a fairly long string if
-    // they include check/mate, qualitative descriptions like
-    // !, ? or +/-, or scores like 1-0.  A good approach
-    // seems to be to try to find a move at the start of the string
-    // and ignore all trailing text.
-    // TODO: Handle white space in move (e.g., N x e4)
-    char clean_str[7] = {0};
-    int i = 0;
-    while ((chessboard_is_piece(move_str[i]) || chessboard_is_file(move_str[i]) ||
-	    chessboard_is_rank(move_str[i]) || move_str[i] == 'x' ||
-	    move_str[i] == '=') && i < 6)
-    {
-	clean_str[i] = move_str[i];
-	i++;
-    }
-    int len = strlen(clean_str);
-    if (len < 2)
-    {
-	return false;
-    }
+    DEBUG_validate_board(cb);
+    return valid;
+}
+
+bool cb88_is_alg_move_valid(chessboard* cb, char* move_str, struct _move* move)
+{
+    struct move_list pseudo;
+    cb88_generate_pseudo_moves(cb, &pseudo);
+    return cb88_find_san_move(cb, move_str, strcspn(move_str, " \t\r\n"), &pseudo, move);
+}
+
+/*
+cb88_find_san_move looks for the move described by the len characters
+at move_str among the moves in "moves", and copies it to move if exactly
+one legal move matches.  The list may be pseudo-legal: only candidates
+that match the text are tested for legality, so a pinned piece doesn't
+make a move ambiguous.  A pawn move to the last rank without a promotion
+piece is taken to be a queen promotion.
+ */
+bool cb88_find_san_move(chessboard* cb, const char* move_str, size_t len,
+			struct move_list* moves, struct _move* move)
+{
+    struct san_move san;
+    if (!san_parse(move_str, len, &san)) return false;
+    return cb88_match_san_move(cb, &san, moves, move);
+}
 
-    // Pawn moves (TODO: promotions are not handled yet.)
-    if (chessboard_is_file(clean_str[0]))
+bool cb88_match_san_move(chessboard* cb, struct san_move* san,
+			 struct move_list* moves, struct _move* move)
+{
+    int moves_found = 0;
+    uint32_t to = (san->castle == SAN_NO_CASTLE) ? cb88_get_square(san->to) : CB88_MAX_INDEX;
+    for (int i = 0; i < moves->count; i++)
     {
-	// Advances are always in the form (file)(rank), like "e4".
-	// There might be other characters like '+' or '#' afterwards,
-	// but if a move begins with (file)(rank) then it must be
-	// a pawn advance.
-	if (chessboard_is_rank(clean_str[1]))
+	struct _move* candidate = &moves->moves[i];
+	if (san->castle != SAN_NO_CASTLE)
 	{
-	    uint32_t to = cb88_get_square_from_chars(clean_str[0], clean_str[1]);
-	    uint32_t file = cb88_get_file(to);
-	    for (int i = 0; i < CB88_MAX_PIECES; i++)
+	    if (!candidate->is_castle ||
+		(candidate->to < candidate->from) != (san->castle == SAN_CASTLE_LONG))
 	    {
-                // It's worth
-		// noting that there can never be two different pawns of the
-		// same color that can *advance* to the same square, but
-		// there may be other pawns on adjacent files that can
-		// capture and go to the same square.  We therefore
-		// need to check that the pawn is moving from the correct
-		// file, but once we find a valid move we can stop.  
-		if ((cb->piecelist[color][i].type == PAWN) &&
-		    (cb88_get_file(cb->piecelist[color][i].square) == file))
-		{
-		    move->to = to;
-		    move->from = cb->piecelist[color][i].square;
-		    valid = cb88_is_move_valid(cb, move);
-		    if (valid) break;
-		}
+		continue;
 	    }
-	    return valid;
 	}
-	// Captures are of the form (file)x(file)(rank), like "exd4".
-	// For the moment we are not allowing the shorthand (file)x(file).
-	// As with advances, there might be extra characters afterwards,
-	// but they can be ignored.
-	if (clean_str[1] == 'x' && len >= 4 &&
-		 chessboard_is_file(clean_str[2]) &&
-		 chessboard_is_rank(clean_str[3]))
+	else if (candidate->to != to ||
+		 cb88_get_piecetype(cb, candidate->from) != san->piece ||
+		 (san->from_file >= 0 && cb88_get_file(candidate->from) != (uint32_t)san->from_file) ||
+		 (san->from_rank >= 0 && cb88_get_rank(candidate->from) != (uint32_t)san->from_rank) ||
+		 (san->promotion == EMPTY ?
+		  (candidate->promotion != EMPTY && candidate->promotion != QUEEN) :
+		  (candidate->promotion != san->promotion)))
 	{
-	    uint32_t to = cb88_get_square_from_chars(clean_str[2], clean_str[3]);
-	    uint32_t file = (uint32_t)(clean_str[0] - 'a');
-	    for (int i = 0; i < CB88_MAX_PIECES; i++)
-	    {
-		struct piece piece = cb->piecelist[color][i];
-		// Similar to the advance version above.
-		if ((piece.type == PAWN) && (cb88_get_file(piece.square) == file))
-		{
-		    move->to = to;
-		    move->from = piece.square;
-		    valid = cb88_is_move_valid(cb, move);
-		    if (valid) break;
-		}
-	    }
-	    return valid;
+	    continue;
 	}
+	if (!cb88_is_move_legal(cb, candidate)) continue;
+	*move = *candidate;
+	moves_found++;
     }
-
-    // Piece moves
-    // All piece moves are of the form
-    // (type)[file_hint][rank_hint][x](file)(rank)
-    // plus some possible extra characters at the end, like '+' or '#'.
-    switch (clean_str[0])
-    {
-    case 'K':
-	valid = _is_alg_piece_move_valid(cb, clean_str, move, KING);
-	break;
-    case 'Q':
-	valid = _is_alg_piece_move_valid(cb, clean_str, move, QUEEN);
-	break;
-    case 'R':
-	valid = _is_alg_piece_move_valid(cb, clean_str, move, ROOK);
-	break;
-    case 'N':
-	valid = _is_alg_piece_move_valid(cb, clean_str, move, KNIGHT);
-	break;
-    case 'B':
-	valid = _is_alg_piece_move_valid(cb, clean_str, move, BISHOP);
-	break;
-    default:
-	break;
-    }
-    return valid;
+    return moves_found == 1;
 }
 
-bool _is_alg_piece_move_valid(chessboard* cb, char* clean_str, struct _move* move, chessboard_piecetype type)
+/*
+The move and any rivals (moves by the same piece type to the same
+square) are found among the pseudo-legal moves of that piece type and
+tested with cb88_is_attacked_after, as is check.  Only a move that gives
+check is played, to see if the other side has a legal reply.
+ */
+bool chessboard_move_to_san(chessboard* cb, chessboard_movespec spec, char* san_str)
 {
-    int len = strlen(clean_str);
-    assert(len >= 2);
-    bool valid = false;
-
-    // The string should already have been cleaned, so all trailing characters
-    // have already been removed.  Once cleaned, every piece move has to end
-    // with the target square in the form of (file)(rank).  
-    if (!(chessboard_is_rank(clean_str[len-1]) && chessboard_is_file(clean_str[len-2])))
-    {
-	return false;
-    }
-    move->to = cb88_get_square_from_chars(clean_str[len-2], clean_str[len-1]);
+    struct move_list moves;
+    struct _move move;
+    struct undo_record undo;
+    chessboard_color color = cb->to_move;
+    uint32_t from = cb88_get_square(spec.from);
+    uint32_t to = cb88_get_square(spec.to);
+    chessboard_piecetype type = cb88_get_piecetype(cb, from);
+    uint64_t rivals = 0;
+    bool found = false;
 
-    // Standard algebraic notation allows (and sometimes requires) a specification
-    // of which rank or file (or both) the piece starts on.  There are only supposed
-    // to be included if necessary, and if either will work then you are supposed
-    // to use files, but we will allow either or both as long as the piece is
-    // unambiguously specified.  Note that we don't allow two ranks or two files.
-    int i = len-3;
-    bool has_rank_hint = false;
-    uint32_t rank_hint = 0;
-    bool has_file_hint = false;
-    uint32_t file_hint = 0;
-    while (i > 0)
+    if (type == EMPTY || cb88_get_color(cb, from) != color) return false;
+    cb88_generate_piece_moves(cb, type, &moves);
+    for (int i = 0; i < moves.count; i++)
     {
-	if (chessboard_is_rank(clean_str[i]) && !has_rank_hint)
+	struct _move* candidate = &moves.moves[i];
+	if (candidate->to != to) continue;
+	uint32_t king = candidate->is_king ? to : cb->king_square[color];
+	if (cb88_is_attacked_after(cb, candidate, king, !color)) continue;
+	if (candidate->from != from)
 	{
-	    has_rank_hint = true;
-	    rank_hint = 7 - (uint32_t)(clean_str[i] - '1');
+	    rivals |= 1ULL << cb88_get_chessboard_square(candidate->from);
 	}
-	else if (chessboard_is_file(clean_str[i]) && !has_file_hint)
+	else if (candidate->promotion == spec.promotion)
 	{
-	    has_file_hint = true;
-	    file_hint = (uint32_t)(clean_str[i] - 'a');
-	}
-	else if (clean_str[i] != 'x')
-	{
-	    // If we get here, then multiple rank hints or
-	    // multiple file hints have been given and the string
-	    // is malformed.
-	    return false;
-	}
-	i--;
-    }
-
-    // We now need to check each piece of the appropriate color and type and
-    // see if it can move to the appropriate square.  Note that
-    // !has_rank_hint || (_get_rank(from) == rank_hint) evaluates to true
-    // if there is no rank hint or if there is a rank hint and the from square
-    // matches the hint.
-    chessboard_color color = cb->to_move;
-    uint32_t from_final = CB88_MAX_INDEX;
-    int moves_found = 0;
-    for (int k = 0; k < CB88_MAX_PIECES; k++)
-    {
-	struct piece piece = cb->piecelist[color][k];
-	uint32_t from = piece.square;
-	if (piece.type == type &&
-	    (!has_rank_hint || (cb88_get_rank(from) == rank_hint)) &&
-	    (!has_file_hint || (cb88_get_file(from) == file_hint)))
-	{
-	    move->from = from;
-	    if (cb88_is_move_valid(cb, move))
-	    {
-		from_final = from;
-		moves_found++;
-	    }
+	    move = *candidate;
+	    found = true;
 	}
     }
+    if (!found) return false;
 
-    // TODO: It would be nice to be able to tell the user if there is no
-    // matching move or too many matching moves.  That would require
-    // rewriting these functions with error codes instead of true/false.
-    if (moves_found == 1)
+    struct san_move san = (struct san_move){.piece=type,
+					    .to=spec.to,
+					    .promotion=move.promotion,
+					    .castle=SAN_NO_CASTLE,
+					    .capture=(cb->board[to] != CB88_NO_PIECE || move.is_en_passant),
+					    .check=SAN_NO_CHECK};
+    if (move.is_castle) san.castle = (to < from) ? SAN_CASTLE_LONG : SAN_CASTLE_SHORT;
+    san_disambiguate(&san, spec.from, rivals);
+    if (cb88_is_attacked_after(cb, &move, cb->king_square[!color], color))
     {
-	move->from = from_final;
-	valid = true;
+	cb88_make_move(cb, &move, &undo);
+	san.check = cb88_has_legal_move(cb) ? SAN_CHECK : SAN_MATE;
+	cb88_unmake_move(cb, &move, &undo);
     }
-    return valid;
+    san_format(&san, san_str);
+    return true;
 }
@@ -4,10 +4,16 @@
 #include "chessboard_api.h"
 #include "chessboard_0x88.h"
 #include "move_0x88.h"
+#include "movegen_0x88.h"
+#include "san.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 bool cb88_is_alg_move_valid(chessboard* cb, char* move_str, struct _move* move);
-bool _is_alg_piece_move_valid(chessboard* cb, char* clean_str, struct _move* move, chessboard_piecetype type);
+bool cb88_find_san_move(chessboard* cb, const char* move_str, size_t len,
+			struct move_list* moves, struct _move* move);
+bool cb88_match_san_move(chessboard* cb, struct san_move* san,
+			 struct move_list* moves, struct _move* move);
 
 #endif
@@ -0,0 +1,145 @@
+#include "chessboard_bb.h"
+#include "san.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+
+/*
+Algebraic notation for the bitboard board.  Instead of checking a move
+against the rules piece by piece, we generate the legal moves and look
+for the single one that matches what san_parse read from the notation.
+ */
+
+bool chessboard_move(chessboard* cb, chessboard_square from, chessboard_square to)
+{
+    struct bb_move_list list;
+    struct bb_undo undo;
+
+    // Promotions are generated queen first, so a pawn reaching the last
+    // rank becomes a queen.
+    bb_generate_moves(cb, &list);
+    for (int i = 0; i < list.count; i++)
+    {
+	if (list.moves[i].from == from && list.moves[i].to == to)
+	{
+	    bb_make_move(cb, &list.moves[i], &undo);
+	    // The API leaves switching the current player to the caller.
+	    chessboard_switch_current_player(cb);
+	    return true;
+	}
+    }
+    return false;
+}
+
+bool chessboard_algmove(chessboard* cb, char* move_str)
+{
+    // Anything after the move itself (like a newline) is ignored.
+    return chessboard_algmove_n(cb, move_str, strcspn(move_str, " \t\r\n"));
+}
+
+bool chessboard_algmove_n(chessboard* cb, const char* move_str, size_t len)
+{
+    struct bb_move_list legal;
+    struct bb_move move;
+    struct bb_undo undo;
+
+    bb_generate_moves(cb, &legal);
+    bool valid = bb_find_san_move(cb, move_str, len, &legal, &move);
+    if (valid)
+    {
+	bb_make_move(cb, &move, &undo);
+	// The API leaves switching the current player to the caller.
+	chessboard_switch_current_player(cb);
+    }
+    return valid;
+}
+
+/*
+bb_find_san_move looks for the move described by the len characters at
+move_str among the legal moves in "legal", and copies it to move if
+exactly one matches.  As with the 0x88 version, a pawn move to the last
+rank without a promotion piece is taken to be a queen promotion.
+ */
+bool bb_find_san_move(chessboard* cb, const char* move_str, size_t len,
+		      struct bb_move_list* legal, struct bb_move* move)
+{
+    struct san_move san;
+    int moves_found = 0;
+
+    if (!san_parse(move_str, len, &san)) return false;
+    for (int i = 0; i < legal->count; i++)
+    {
+	struct bb_move* candidate = &legal->moves[i];
+	if (san.castle != SAN_NO_CASTLE)
+	{
+	    if (!(candidate->flags & BB_FLAG_CASTLE) ||
+		(candidate->to < candidate->from) != (san.castle == SAN_CASTLE_LONG))
+	    {
+		continue;
+	    }
+	}
+	else if (candidate->to != san.to || candidate->piece != san.piece ||
+		 (san.from_file >= 0 && candidate->from % 8 != san.from_file) ||
+		 (san.from_rank >= 0 && candidate->from / 8 != san.from_rank) ||
+		 (san.promotion == EMPTY ?
+		  (candidate->promotion != EMPTY && candidate->promotion != QUEEN) :
+		  (candidate->promotion != san.promotion)))
+	{
+	    continue;
+	}
+	*move = *candidate;
+	moves_found++;
+    }
+    return moves_found == 1;
+}
+
+// See the 0x88 version.
+bool chessboard_move_to_san(chessboard* cb, chessboard_movespec spec, char* san_str)
+{
+    struct bb_move_list moves;
+    struct bb_move move;
+    struct bb_undo undo;
+    chessboard_color color = cb->to_move;
+    chessboard_piecetype type = bb_get_piecetype(cb, spec.from, color);
+    uint32_t king = bb_lsb(cb->pieces[color][KING]);
+    uint64_t rivals = 0;
+    bool found = false;
+
+    if (type == EMPTY) return false;
+    bb_generate_pseudo_moves(cb, &moves);
+    for (int i = 0; i < moves.count; i++)
+    {
+	struct bb_move* candidate = &moves.moves[i];
+	if (candidate->to != spec.to || candidate->piece != type) continue;
+	if (bb_is_attacked_after(cb, candidate, (type == KING) ? spec.to : king, !color)) continue;
+	if (candidate->from != spec.from)
+	{
+	    rivals |= BB_BIT(candidate->from);
+	}
+	else if (candidate->promotion == spec.promotion)
+	{
+	    move = *candidate;
+	    found = true;
+	}
+    }
+    if (!found) return false;
+
+    struct san_move san = (struct san_move){.piece=type,
+					    .to=spec.to,
+					    .promotion=move.promotion,
+					    .castle=SAN_NO_CASTLE,
+					    .capture=((cb->occupied[!color] & BB_BIT(spec.to)) ||
+						      (move.flags & BB_FLAG_EN_PASSANT)),
+					    .check=SAN_NO_CHECK};
+    if (move.flags & BB_FLAG_CASTLE) san.castle = (spec.to < spec.from) ? SAN_CASTLE_LONG : SAN_CASTLE_SHORT;
+    san_disambiguate(&san, spec.from, rivals);
+    if (bb_is_attacked_after(cb, &move, bb_lsb(cb->pieces[!color][KING]), color))
+    {
+	bb_make_move(cb, &move, &undo);
+	san.check = bb_has_legal_move(cb) ? SAN_CHECK : SAN_MATE;
+	bb_unmake_move(cb, &move, &undo);
+    }
+    san_format(&san, san_str);
+    return true;
+}
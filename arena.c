@@ -0,0 +1,49 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+chessboard_arena* arena_allocate(size_t capacity, size_t board_size)
+{
+    chessboard_arena* arena = (chessboard_arena *)malloc(sizeof(chessboard_arena));
+    if (!arena)
+    {
+	printf("DEBUG: Failed to allocate arena\n");
+	return NULL;
+    }
+
+    arena->stride = (board_size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    arena->capacity = capacity;
+    arena->used = 0;
+    // aligned_alloc wants a whole number of alignments, which an empty
+    // arena isn't.
+    arena->boards = (unsigned char *)aligned_alloc(ARENA_ALIGNMENT,
+						   (capacity ? capacity : 1) * arena->stride);
+    if (!arena->boards)
+    {
+	printf("DEBUG: Failed to allocate %zu arena boards\n", capacity);
+	free(arena);
+	return NULL;
+    }
+    return arena;
+}
+
+void* arena_take(chessboard_arena* arena, size_t count)
+{
+    if (count > arena->capacity - arena->used) return NULL;
+    void* boards = arena->boards + arena->used * arena->stride;
+    arena->used += count;
+    return boards;
+}
+
+void chessboard_arena_reset(chessboard_arena* arena)
+{
+    arena->used = 0;
+}
+
+void chessboard_arena_free(chessboard_arena* arena)
+{
+    assert(arena && "Tried to free null pointer to arena");
+    free(arena->boards);
+    free(arena);
+}
@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "chessboard_api.h"
+#include <stddef.h>
+
+/*
+Chessboard arenas (see chessboard_arena_allocate in chessboard_api.h),
+shared by all of the board representations.  An arena is just a block
+of fixed-size slots and a count of how many have been handed out, so it
+only needs to know how big a board is.  Each representation allocates
+the arena with its own sizeof(chessboard) and sets up the boards that
+arena_take returns.
+
+Slots are rounded up to a whole number of cache lines, so that boards
+used by different threads never share a line.
+ */
+#define ARENA_ALIGNMENT 64
+
+struct chessboard_arena {
+    unsigned char* boards;
+    size_t stride;
+    size_t capacity;
+    size_t used;
+};
+
+chessboard_arena* arena_allocate(size_t capacity, size_t board_size);
+// Returns the first of "count" consecutive slots, or a null pointer.
+void* arena_take(chessboard_arena* arena, size_t count);
+
+#endif
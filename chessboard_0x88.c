@@ -1,4 +1,7 @@
 #include "chessboard_0x88.h"
+#include "fen.h"
+#include "pack.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <stdint.h>
@@ -29,12 +32,14 @@ it is nonzero then the square is illegal.
 
 Since only the array indices are needed to decide if squares are legal 
 or not, the contents of the array are free to hold whatever information
-we want.  We will follow a common choice and make the board be an 
-array of pointers to pieces.  Squares without pieces (including both
-empty and illegal squares) will contain a null pointer.  The pieces 
-will be organized in a 2x16 array, where one row holds the white pieces
-and the other row holds the black pieces.  This will make it easy to
-loop through pieces when necessary.
+we want.  The pieces themselves live in a 2x16 piecelist, where one row
+holds the white pieces and the other row holds the black pieces, which
+makes it easy to loop through them.  Each board entry is one byte: the
+piece's slot in the piecelist, color * 16 + index (see CB88_SLOT), so
+the color is just the high bits.  Squares without pieces (including
+both empty and illegal squares) hold CB88_NO_PIECE.  One-byte entries
+keep the whole board, piecelist included, to a few cache lines, which
+is what makes copying a board cheap.
  
 TODO: All of the chessboard_api functions that take a chessboard_square
 as an argument have a corresponding function with a leading underscore
@@ -76,10 +81,10 @@ void DEBUG_print_board(chessboard* cb)
 {
     for (uint32_t i = 0; i < CB88_MAX_INDEX; i++)
     {
-	if (cb->board[i])
+	if (cb->board[i] != CB88_NO_PIECE)
 	{
 	    printf("Piece on square %u\n", i);
-	    DEBUG_print_piece(cb->board[i]);
+	    DEBUG_print_piece(CB88_PIECE_AT(cb, i));
 	}
     }
 }
@@ -142,24 +147,16 @@ void DEBUG_validate_board(chessboard* cb)
 
     for (uint32_t square = 0; square < CB88_MAX_INDEX; square++)
     {
-	if (cb->board[square])
+	uint8_t slot = cb->board[square];
+	if (slot != CB88_NO_PIECE)
 	{
-	    // WARNING: This is meant to check if cb->board[square]
-	    // points to an element of cb->piecelist.  Technically,
-	    // the behavior of these pointer comparisons is
-	    // unspecified if cb->board[square] points outside the
-	    // array.  I'm only running the debug code on my computer
-	    // though, and it seems to work fine here.  As I understand
-	    // it, this works as expected on the vast majority of
-	    // systems.
-	    valid = (cb->board[square] >= &cb->piecelist[0][0]) &&
-		(cb->board[square] <= &cb->piecelist[1][CB88_MAX_INDEX-1]);
-	    if (!valid) printf("Square %d has invalid address %p\n", square, cb->board[square]);
+	    valid = (slot < CB88_SLOT(CHESSBOARD_MAX_COLOR, 0));
+	    if (!valid) printf("Square %d has invalid slot %d\n", square, slot);
 	    assert(valid);
 	    
-	    struct piece piece = *(cb->board[square]);
+	    struct piece piece = *CB88_SLOT_PIECE(cb, slot);
 	    valid = (piece.square == square);
-	    if (!valid) printf("board[%d] points to piece with square %d\n", square, piece.square);
+	    if (!valid) printf("board[%d] holds piece with square %d\n", square, piece.square);
 	    assert(valid);
 	    
 	    // WARNING: This relies on the fact that types are ordered
@@ -197,16 +194,26 @@ void DEBUG_validate_board(chessboard* cb)
 	    }
 	    else
 	    {
-		valid = cb->board[piece.square];
-		if (!valid) printf("Piecelist[%d][%d] has square %d, but cb->board[%d] is null\n", color, i, piece.square, piece.square);
+		valid = (cb->board[piece.square] != CB88_NO_PIECE);
+		if (!valid) printf("Piecelist[%d][%d] has square %d, but cb->board[%d] is empty\n", color, i, piece.square, piece.square);
 		assert(valid);
 
-		valid = cb->board[piece.square] == &(cb->piecelist[color][i]);
-		if (!valid) printf("Piecelist[%d][%d] has square %d, but cb->board[%d] points to %p (should be %p)\n", color, i, piece.square, piece.square, cb->board[piece.square], &(cb->piecelist[color][i]));
+		valid = (cb->board[piece.square] == CB88_SLOT(color, i));
+		if (!valid) printf("Piecelist[%d][%d] has square %d, but cb->board[%d] holds slot %d (should be %d)\n", color, i, piece.square, piece.square, cb->board[piece.square], CB88_SLOT(color, i));
 		assert(valid);
 	    }
 	}
     }
+
+    valid = (cb->hash == cb88_compute_hash(cb));
+    if (!valid) printf("Hash is %016llx but should be %016llx\n", (unsigned long long)cb->hash, (unsigned long long)cb88_compute_hash(cb));
+    assert(valid);
+
+    int32_t mg, eg, phase;
+    cb88_compute_eval(cb, &mg, &eg, &phase);
+    valid = (cb->eval_mg == mg) && (cb->eval_eg == eg) && (cb->phase == phase);
+    if (!valid) printf("Eval is %d/%d/%d but should be %d/%d/%d\n", cb->eval_mg, cb->eval_eg, cb->phase, mg, eg, phase);
+    assert(valid);
 }
 #else // #ifndef NDEBUG
 void DEBUG_print_piecelist(chessboard* cb) {}
@@ -215,26 +222,43 @@ void DEBUG_print_piece(struct piece* piece) {}
 void DEBUG_validate_board(chessboard* cb) {}
 #endif // #ifndef NDEBUG
 
+// Sets up a newly allocated board as an empty board.
+void _cb88_init_board(chessboard* cb)
+{
+    for (int index = 0; index < CB88_MAX_INDEX; index++)
+    {
+	cb->board[index] = CB88_NO_PIECE;
+    }
+    for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int piece = 0; piece < CB88_MAX_PIECES; piece++)
+	{
+	    cb->piecelist[color][piece] =
+		(struct piece){.color=CHESSBOARD_MAX_COLOR,
+				.type=EMPTY,
+				.square=CB88_MAX_INDEX};
+	}
+    }
+    cb->to_move = CHESSBOARD_MAX_COLOR;
+    cb->ep_square = CB88_MAX_INDEX;
+    cb->halfmove_clock = 0;
+    cb->fullmove_number = 1;
+    cb->king_square[WHITE] = CB88_MAX_INDEX;
+    cb->king_square[BLACK] = CB88_MAX_INDEX;
+    cb->hash = 0;
+    cb->eval_mg = 0;
+    cb->eval_eg = 0;
+    cb->phase = 0;
+}
+
 chessboard* chessboard_allocate()
 {
     chessboard* cb = (chessboard *)malloc(sizeof(chessboard));
     if (cb)
     {
-	for (int index = 0; index < CB88_MAX_INDEX; index++)
-	{
-	    cb->board[index] = 0;
-	}
-	for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
-	{
-	    for (int piece = 0; piece < CB88_MAX_PIECES; piece++)
-	    {
-		cb->piecelist[color][piece] =
-		    (struct piece){.color=CHESSBOARD_MAX_COLOR,
-				    .type=EMPTY,
-				    .square=CB88_MAX_INDEX};
-	    }
-	}
-	cb->to_move = CHESSBOARD_MAX_COLOR;
+	zobrist_init();
+	cb88_eval_init();
+	_cb88_init_board(cb);
     }
     else
     {
@@ -249,10 +273,49 @@ void chessboard_free(chessboard* cb)
     free(cb);
 }
 
+chessboard_arena* chessboard_arena_allocate(size_t capacity)
+{
+    zobrist_init();
+    cb88_eval_init();
+    return arena_allocate(capacity, sizeof(chessboard));
+}
+
+bool chessboard_allocate_many(chessboard_arena* arena, size_t count, chessboard** boards)
+{
+    unsigned char* first = (unsigned char *)arena_take(arena, count);
+    if (!first) return false;
+    for (size_t i = 0; i < count; i++)
+    {
+	boards[i] = (chessboard *)(first + i * arena->stride);
+	_cb88_init_board(boards[i]);
+    }
+    return true;
+}
+
+// Empties the board and piecelist, leaving the rest of the state alone.
+void _cb88_clear_board(chessboard* cb)
+{
+    for (int index = 0; index < CB88_MAX_INDEX; index++) cb->board[index] = CB88_NO_PIECE;
+    for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int i = 0; i < CB88_MAX_PIECES; i++)
+	{
+	    cb->piecelist[color][i] = (struct piece){.color=CHESSBOARD_MAX_COLOR,
+						     .type=EMPTY,
+						     .square=CB88_MAX_INDEX};
+	}
+	cb->king_square[color] = CB88_MAX_INDEX;
+    }
+}
+
 void chessboard_initialize_board(chessboard* cb)
 {
+    _cb88_clear_board(cb);
     cb->to_move = WHITE;
     cb->castle = (struct castle_rights){true, true, true, true};
+    cb->ep_square = CB88_MAX_INDEX;
+    cb->halfmove_clock = 0;
+    cb->fullmove_number = 1;
     
     for (enum chessboard_square square = A7; square < A6; square++)
     {
@@ -280,30 +343,133 @@ void chessboard_initialize_board(chessboard* cb)
     cb88_set_square(cb, cb88_get_square(F1), BISHOP, WHITE);
     cb88_set_square(cb, cb88_get_square(G1), KNIGHT, WHITE);
     cb88_set_square(cb, cb88_get_square(H1), ROOK, WHITE);
+    cb->hash = cb88_compute_hash(cb);
+    cb88_compute_eval(cb, &cb->eval_mg, &cb->eval_eg, &cb->phase);
 
     DEBUG_validate_board(cb);
 }
 
+/*
+cb88_set_position and cb88_get_position copy the pieces and state in and
+out of the mailbox that FEN and packed positions share (see fen.h).
+cb88_set_position writes the pieces straight into the piecelist, in
+board order, rather than through cb88_set_square, and computes the hash
+and evaluation once at the end.
+ */
+void cb88_set_position(chessboard* cb, struct fen_position* position)
+{
+    int counts[CHESSBOARD_MAX_COLOR] = {0, 0};
+
+    _cb88_clear_board(cb);
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	chessboard_piecetype type = position->types[square];
+	if (type == EMPTY) continue;
+	chessboard_color color = position->colors[square];
+	uint32_t index = cb88_get_square(square);
+	cb->piecelist[color][counts[color]] = (struct piece){.color=color, .type=type, .square=index};
+	cb->board[index] = CB88_SLOT(color, counts[color]++);
+	if (type == KING) cb->king_square[color] = index;
+    }
+
+    cb->to_move = position->to_move;
+    cb->castle = (struct castle_rights){
+	.white_short=(position->castle & ZOBRIST_WHITE_SHORT) != 0,
+	.white_long=(position->castle & ZOBRIST_WHITE_LONG) != 0,
+	.black_short=(position->castle & ZOBRIST_BLACK_SHORT) != 0,
+	.black_long=(position->castle & ZOBRIST_BLACK_LONG) != 0};
+    cb->ep_square = (position->ep_square == CHESSBOARD_MAX_SQUARE) ?
+	CB88_MAX_INDEX : cb88_get_square(position->ep_square);
+    cb->halfmove_clock = position->halfmove_clock;
+    cb->fullmove_number = position->fullmove_number;
+    cb->hash = cb88_compute_hash(cb);
+    cb88_compute_eval(cb, &cb->eval_mg, &cb->eval_eg, &cb->phase);
+
+    DEBUG_validate_board(cb);
+}
+
+void cb88_get_position(chessboard* cb, struct fen_position* position)
+{
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	struct piece* piece = CB88_PIECE_AT(cb, cb88_get_square(square));
+	position->types[square] = piece ? piece->type : EMPTY;
+	position->colors[square] = piece ? piece->color : CHESSBOARD_MAX_COLOR;
+    }
+    position->to_move = cb->to_move;
+    position->castle = (cb->castle.white_short ? ZOBRIST_WHITE_SHORT : 0) |
+	(cb->castle.white_long ? ZOBRIST_WHITE_LONG : 0) |
+	(cb->castle.black_short ? ZOBRIST_BLACK_SHORT : 0) |
+	(cb->castle.black_long ? ZOBRIST_BLACK_LONG : 0);
+    position->ep_square = (cb->ep_square == CB88_MAX_INDEX) ?
+	CHESSBOARD_MAX_SQUARE : cb88_get_chessboard_square(cb->ep_square);
+    position->halfmove_clock = cb->halfmove_clock;
+    position->fullmove_number = cb->fullmove_number;
+}
+
+bool chessboard_set_fen(chessboard* cb, const char* fen)
+{
+    struct fen_position position;
+
+    if (!fen_parse(fen, &position)) return false;
+    cb88_set_position(cb, &position);
+    return true;
+}
+
+void chessboard_get_fen(chessboard* cb, char* fen)
+{
+    struct fen_position position;
+
+    cb88_get_position(cb, &position);
+    fen_format(&position, fen);
+}
+
+void chessboard_pack(chessboard* cb, chessboard_packed* packed)
+{
+    struct fen_position position;
+
+    cb88_get_position(cb, &position);
+    pack_position(&position, packed);
+}
+
+bool chessboard_unpack(chessboard* cb, const chessboard_packed* packed)
+{
+    struct fen_position position;
+
+    if (!unpack_position(packed, &position)) return false;
+    cb88_set_position(cb, &position);
+    return true;
+}
+
+/*
+The board refers to pieces by their piecelist slot rather than by
+pointer, so a chessboard can be copied as plain bytes.  
+ */
+void cb88_copy_board(chessboard* dst, chessboard* src)
+{
+    *dst = *src;
+}
+
 chessboard_piecetype chessboard_get_piecetype(chessboard* cb, chessboard_square square)
 {
-    uint32_t index = cb88_get_square(square);
-    return cb->board[index] ? cb->board[index]->type : EMPTY;
+    return cb88_get_piecetype(cb, cb88_get_square(square));
 }
 
 chessboard_piecetype cb88_get_piecetype(chessboard* cb, uint32_t square)
 {
-    return cb->board[square] ? cb->board[square]->type : EMPTY;
+    uint8_t slot = cb->board[square];
+    return (slot == CB88_NO_PIECE) ? EMPTY : CB88_SLOT_PIECE(cb, slot)->type;
 }
 
 chessboard_color chessboard_get_color(chessboard* cb, chessboard_square square)
 {
-    uint32_t index = cb88_get_square(square);
-    return cb->board[index] ? cb->board[index]->color : CHESSBOARD_MAX_COLOR;
+    return cb88_get_color(cb, cb88_get_square(square));
 }
 
 chessboard_color cb88_get_color(chessboard* cb, uint32_t square)
 {
-    return cb->board[square] ? cb->board[square]->color : CHESSBOARD_MAX_COLOR;
+    uint8_t slot = cb->board[square];
+    return (slot == CB88_NO_PIECE) ? CHESSBOARD_MAX_COLOR : (chessboard_color)CB88_SLOT_COLOR(slot);
 }
 
 chessboard_color chessboard_get_current_player(chessboard *cb)
@@ -317,6 +483,49 @@ void chessboard_switch_current_player(chessboard *cb)
     // 1.  If other colors are used for some reason (maybe to indicate
     // an error) then this will cause problems.
     cb->to_move = !(cb->to_move);
+    cb->hash ^= zobrist_black_to_move;
+}
+
+uint64_t chessboard_get_hash(chessboard* cb)
+{
+    return cb->hash;
+}
+
+uint64_t cb88_piece_key(chessboard_color color, chessboard_piecetype type, uint32_t square)
+{
+    return zobrist_pieces[color][type][cb88_get_chessboard_square(square)];
+}
+
+/*
+cb88_state_key is the part of the hash that comes from the castling
+rights and en passant square.  Code that changes either can XOR it out
+before the change and back in afterwards.  
+ */
+uint64_t cb88_state_key(chessboard* cb)
+{
+    uint32_t mask = (cb->castle.white_short ? ZOBRIST_WHITE_SHORT : 0) |
+	(cb->castle.white_long ? ZOBRIST_WHITE_LONG : 0) |
+	(cb->castle.black_short ? ZOBRIST_BLACK_SHORT : 0) |
+	(cb->castle.black_long ? ZOBRIST_BLACK_LONG : 0);
+    uint64_t key = zobrist_castle[mask];
+    if (cb->ep_square != CB88_MAX_INDEX) key ^= zobrist_ep_file[cb88_get_file(cb->ep_square)];
+    return key;
+}
+
+// Computes the hash from scratch, rather than incrementally.
+uint64_t cb88_compute_hash(chessboard* cb)
+{
+    uint64_t hash = cb88_state_key(cb);
+    if (cb->to_move == BLACK) hash ^= zobrist_black_to_move;
+    for (chessboard_color color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int i = 0; i < CB88_MAX_PIECES; i++)
+	{
+	    struct piece* piece = &cb->piecelist[color][i];
+	    if (piece->type != EMPTY) hash ^= cb88_piece_key(color, piece->type, piece->square);
+	}
+    }
+    return hash;
 }
 
 uint32_t cb88_get_square(chessboard_square square)
@@ -326,6 +535,13 @@ uint32_t cb88_get_square(chessboard_square square)
     return internal_squares[square];
 }
 
+// The inverse of cb88_get_square: drop the 0x88 gap between ranks.
+chessboard_square cb88_get_chessboard_square(uint32_t square)
+{
+    assert(cb88_is_square_legal(square));
+    return (chessboard_square)(((square & 0x70) >> 1) | (square & 0x07));
+}
+
 uint32_t cb88_get_square_from_chars(char file, char rank)
 {
     return (7 - (uint32_t)(rank - '1')) * 16 + (uint32_t)(file - 'a');
@@ -374,19 +590,29 @@ int cb88_set_square(chessboard* cb, uint32_t square, chessboard_piecetype type,
     cb->piecelist[color][i] = (struct piece){.color=color,
 					      .type=type,
 					      .square=square};
-    cb->board[square] = &(cb->piecelist[color][i]);
+    cb->board[square] = CB88_SLOT(color, i);
+    if (type == KING) cb->king_square[color] = square;
+    cb->hash ^= cb88_piece_key(color, type, square);
+    cb->eval_mg += cb88_eval_mg[color][type][square];
+    cb->eval_eg += cb88_eval_eg[color][type][square];
+    cb->phase += cb88_phase_weights[type];
 
     return 0;
 }
 
 void cb88_clear_square(chessboard* cb, uint32_t square)
 {
-    if (cb->board[square])
+    if (cb->board[square] != CB88_NO_PIECE)
     {
-	*(cb->board[square]) =
-	    (struct piece){.color=CHESSBOARD_MAX_COLOR,
-			    .type=EMPTY,
-			    .square=CB88_MAX_INDEX};
+	struct piece* piece = CB88_PIECE_AT(cb, square);
+	if (piece->type == KING) cb->king_square[piece->color] = CB88_MAX_INDEX;
+	cb->hash ^= cb88_piece_key(piece->color, piece->type, square);
+	cb->eval_mg -= cb88_eval_mg[piece->color][piece->type][square];
+	cb->eval_eg -= cb88_eval_eg[piece->color][piece->type][square];
+	cb->phase -= cb88_phase_weights[piece->type];
+	*piece = (struct piece){.color=CHESSBOARD_MAX_COLOR,
+				.type=EMPTY,
+				.square=CB88_MAX_INDEX};
     }
-    cb->board[square] = NULL;
+    cb->board[square] = CB88_NO_PIECE;
 }
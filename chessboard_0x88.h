@@ -2,13 +2,28 @@
 #define CHESSBOARD_0X88_H
 
 #include "chessboard_api.h"
+#include "zobrist.h"
+#include "eval_0x88.h"
+#include "fen.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+#define CB88_MAX_INDEX 128
+#define CB88_MAX_PIECES  16
+
+/*
+Everything on the board is stored in single bytes, so that the whole
+chessboard is a few cache lines and copying one is cheap.  A piece's
+color and type are chessboard_colors and chessboard_piecetypes, and its
+square is a 0x88 index (CB88_MAX_INDEX for an empty piecelist slot).
+The spare byte rounds a piece up to 4 bytes, which measured faster to
+index than 3.
+ */
 struct piece {
-    chessboard_color color;
-    chessboard_piecetype type;
-    uint32_t square;
+    uint8_t color;
+    uint8_t type;
+    uint8_t square;
+    uint8_t unused;
 };
 
 struct castle_rights {
@@ -18,16 +33,43 @@ struct castle_rights {
     bool black_long;
 };
 
+/*
+board holds, for each square, the slot in piecelist of the piece on it,
+numbered color * CB88_MAX_PIECES + index (see CB88_SLOT), or
+CB88_NO_PIECE if the square is empty.  CB88_SLOT_COLOR of an empty
+square is neither WHITE nor BLACK, so a square can be tested for an
+enemy or empty square without looking at the piece.
+ */
+#define CB88_NO_PIECE 0xFF
+#define CB88_SLOT(color, index) ((color) * CB88_MAX_PIECES + (index))
+#define CB88_SLOT_COLOR(slot) ((slot) >> 4)
+#define CB88_SLOT_PIECE(cb, slot) (&(cb)->piecelist[0][0] + (slot))
+#define CB88_PIECE_AT(cb, index) \
+    (((cb)->board[index] == CB88_NO_PIECE) ? NULL : CB88_SLOT_PIECE(cb, (cb)->board[index]))
+
 struct chessboard {
-    struct piece * board[128];
-    struct piece piecelist[2][16];
+    uint8_t board[CB88_MAX_INDEX];
+    struct piece piecelist[2][CB88_MAX_PIECES];
     chessboard_color to_move;
     struct castle_rights castle;
+    // Square a pawn skipped over with a double step on the last move,
+    // or CB88_MAX_INDEX if there is no en passant capture available.
+    uint8_t ep_square;
+    // Where each king is, or CB88_MAX_INDEX if there isn't one yet.
+    uint8_t king_square[2];
+    // Moves since the last capture or pawn move, for the fifty move
+    // rule, and the number of the current full move (starting at 1).
+    uint32_t halfmove_clock;
+    uint32_t fullmove_number;
+    // Zobrist hash of the position (see zobrist.h)
+    uint64_t hash;
+    // Material plus piece-square values, white minus black, for the
+    // middlegame and endgame, and the game phase (see eval_0x88.h).
+    int32_t eval_mg;
+    int32_t eval_eg;
+    int32_t phase;
 };
 
-#define CB88_MAX_INDEX 128
-#define CB88_MAX_PIECES  16
-
 void DEBUG_print_piecelist(chessboard* cb);
 void DEBUG_print_board(chessboard* cb);
 void DEBUG_print_piece(struct piece* piece);
@@ -37,11 +79,22 @@ chessboard_color cb88_get_color(chessboard* cb, uint32_t square);
 chessboard_piecetype cb88_get_piecetype(chessboard* cb, uint32_t square);
 
 uint32_t cb88_get_square(chessboard_square square);
+chessboard_square cb88_get_chessboard_square(uint32_t square);
 uint32_t cb88_get_square_from_chars(char file, char rank);
 bool cb88_is_square_legal(uint32_t square);
 uint32_t cb88_get_file(uint32_t square);
 uint32_t cb88_get_rank(uint32_t square);
 
+void cb88_copy_board(chessboard* dst, chessboard* src);
+void cb88_set_position(chessboard* cb, struct fen_position* position);
+void cb88_get_position(chessboard* cb, struct fen_position* position);
+void _cb88_init_board(chessboard* cb);
+void _cb88_clear_board(chessboard* cb);
+
+uint64_t cb88_piece_key(chessboard_color color, chessboard_piecetype type, uint32_t square);
+uint64_t cb88_state_key(chessboard* cb);
+uint64_t cb88_compute_hash(chessboard* cb);
+
 int cb88_set_square(chessboard* cb, uint32_t square, chessboard_piecetype type, chessboard_color color);
 void cb88_clear_square(chessboard* cb, uint32_t square);
 
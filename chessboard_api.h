@@ -2,6 +2,8 @@
 #define CHESSBOARD_API_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 /*
 Chessboard API
@@ -60,17 +62,102 @@ chessboards should always be created through chessboard_allocate.
 (We may need to add some more allocation methods later for memory
 efficiency purposes.)  chessboard_allocate returns a null pointer
 if allocation fails.  It is up to the caller to free any chessboards
-they allocate using chessboard_free.  
+they allocate using chessboard_free.  Boards (and arenas, below) may be
+allocated from any number of threads at once, including the first
+allocation, which also fills in the representation's shared tables.
  */
 chessboard* chessboard_allocate();
 void chessboard_free(chessboard* cb);
 
+/*
+For programs that go through a lot of boards (one per request, or per
+worker thread), chessboard_arena_allocate sets aside room for
+"capacity" boards in one block, each starting on its own cache line.
+chessboard_allocate_many then hands out "count" of them, in order, into
+"boards".  It returns false (and hands out none) if the arena doesn't
+have room for all of them.  Boards come out in the same state as from
+chessboard_allocate.
+
+Boards from an arena are never freed one at a time.  Instead,
+chessboard_arena_reset takes them all back at once (without touching
+them), after which none of them may be used.  chessboard_arena_free
+frees the arena and every board in it.  An arena may only be used by
+one thread at a time, so each thread should have its own.
+ */
+typedef struct chessboard_arena chessboard_arena;
+
+chessboard_arena* chessboard_arena_allocate(size_t capacity);
+bool chessboard_allocate_many(chessboard_arena* arena, size_t count, chessboard** boards);
+void chessboard_arena_reset(chessboard_arena* arena);
+void chessboard_arena_free(chessboard_arena* arena);
+
 /*
 chessboard_initialize_board sets up an already allocated chessboard in
 the standard starting position (with white to move).
  */
 void chessboard_initialize_board(chessboard* cb);
 
+/*
+chessboard_set_fen sets up an already allocated chessboard from a
+position in Forsyth-Edwards Notation, like
+
+rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1
+
+The move clocks at the end may be left off, as they are in EPD, and
+anything after them (such as EPD operations) is ignored.  It returns
+false if the FEN is malformed, in which case the board has to be set
+up again before it is used.  Positions the move generators can't play
+from count as malformed: each side must have exactly one king, the
+player not to move can't be in check, pawns can't be on rank 1 or 8,
+every castling right needs its king and rook on their home squares, and
+an en passant square needs the enemy pawn that just passed it.
+
+chessboard_get_fen writes the position as FEN into "fen", which must 
+have room for CHESSBOARD_MAX_FEN characters.  
+
+Neither function allocates memory, so they are cheap enough to load
+whole test suites and databases with.  
+ */
+#define CHESSBOARD_MAX_FEN 128
+
+bool chessboard_set_fen(chessboard* cb, const char* fen);
+void chessboard_get_fen(chessboard* cb, char* fen);
+
+/*
+chessboard_pack stores the position in CHESSBOARD_PACKED_SIZE bytes, for
+keeping large numbers of positions in memory or on disk.
+chessboard_unpack sets up an already allocated chessboard from one,
+returning false (like chessboard_set_fen) if it isn't a valid packing.
+
+The layout is the same in every representation and on every machine,
+and each position has exactly one packing, so packed positions can be
+compared and hashed as plain bytes:
+
+bytes 0-7    occupancy, little endian, with bit n set if square n has
+             a piece on it
+bytes 8-23   a 4 bit code for each piece, in square order, two to a
+             byte with the first in the low half.  The code is the
+             piecetype, plus 8 for black pieces.  Unused codes are 0.
+byte 24      bit 0 set if black is to move, and the castling rights
+             (the ZOBRIST_ bits) in bits 1-4
+byte 25      the en passant square, or CHESSBOARD_MAX_SQUARE
+byte 26      the halfmove clock (at most 255)
+bytes 27-28  the fullmove number, little endian (at most 65535)
+bytes 29-31  zero
+
+The first CHESSBOARD_PACKED_KEY_SIZE bytes don't depend on the move
+clocks, so comparing only those finds repeated positions.
+ */
+#define CHESSBOARD_PACKED_SIZE 32
+#define CHESSBOARD_PACKED_KEY_SIZE 26
+
+typedef struct chessboard_packed {
+    uint8_t bytes[CHESSBOARD_PACKED_SIZE];
+} chessboard_packed;
+
+void chessboard_pack(chessboard* cb, chessboard_packed* packed);
+bool chessboard_unpack(chessboard* cb, const chessboard_packed* packed);
+
 /*
 chessboard_is_rank, is_file and is_piece check if characters are the 
 standard algebraic notation for a rank, file or piece type, respectively.
@@ -115,4 +202,88 @@ returns true.  Otherwise it returns false.
  */
 bool chessboard_algmove(chessboard* cb, char* move_str);
 
+/*
+chessboard_algmove_n does the same for a move given as the "len"
+characters at move_str, which needn't be null terminated.  This lets
+moves be read straight out of a larger buffer, like a PGN file.
+ */
+bool chessboard_algmove_n(chessboard* cb, const char* move_str, size_t len);
+
+/*
+chessboard_get_hash returns a 64 bit Zobrist hash of the position,
+which covers the pieces, the player to move, the castling rights and 
+the en passant square.  The same position always has the same hash (in
+every representation), and different positions almost never do.  The 
+hash is kept up to date as moves are made, so this is cheap to call.
+ */
+uint64_t chessboard_get_hash(chessboard* cb);
+
+/*
+Moves that are reported back to the caller are described by their from
+and to squares, plus the piecetype a pawn promotes to (EMPTY if the
+move is not a promotion).  No position has more than
+CHESSBOARD_MAX_MOVES legal moves, so arrays of that length are always
+big enough.
+ */
+#define CHESSBOARD_MAX_MOVES 256
+
+typedef struct chessboard_movespec {
+    chessboard_square from;
+    chessboard_square to;
+    chessboard_piecetype promotion;
+} chessboard_movespec;
+
+/*
+chessboard_perft counts the leaf nodes of the tree of legal moves from
+the current position, "depth" moves deep.  The counts are well known 
+for many positions, which makes this the standard correctness test and
+benchmark for move generation.  
+
+chessboard_divide does the same, but breaks the count down by the legal
+moves at the root.  It fills "moves" and "counts" (which must each have
+room for CHESSBOARD_MAX_MOVES entries) and returns the number of legal
+moves.  
+
+Both functions leave the position as they found it.  depth must be at
+least 1.
+ */
+uint64_t chessboard_perft(chessboard* cb, int depth);
+int chessboard_divide(chessboard* cb, int depth, chessboard_movespec* moves, uint64_t* counts);
+
+/*
+chessboard_perft_hashed returns the same count as chessboard_perft, but
+looks up and stores the counts of subtrees in "table", so that positions
+reached by more than one move order are only counted once.  This is
+what makes deep perfts (depth 7 and up) practical.  Tables come from
+chessboard_perft_table_allocate, which takes the size in megabytes and
+returns a null pointer if allocation fails, and are freed with
+chessboard_perft_table_free.
+
+A table may be shared by any number of threads at once (each with its
+own board), and by every representation, since it is keyed by
+chessboard_get_hash.  A table's counts stay good for as long as it
+lives, so one table can be reused across depths and positions.
+ */
+typedef struct perft_table chessboard_perft_table;
+
+chessboard_perft_table* chessboard_perft_table_allocate(size_t megabytes);
+void chessboard_perft_table_free(chessboard_perft_table* table);
+uint64_t chessboard_perft_hashed(chessboard* cb, int depth, chessboard_perft_table* table);
+
+/*
+chessboard_move_to_san writes a legal move in standard algebraic
+notation, like "Nbd7", "exd8=Q+" or "O-O-O#", into "san", which must
+have room for CHESSBOARD_MAX_SAN characters.  The from square is only
+given as far as it is needed to tell the move apart from other legal
+moves.  A promotion must name its piece.  It returns false (and leaves
+"san" alone) if the move isn't legal.  The position is not changed.
+
+This is meant for writing out principal variations and whole games,
+so no move is played to work out the notation except, for moves that
+give check, the move itself (to see if it is mate).
+ */
+#define CHESSBOARD_MAX_SAN 8
+
+bool chessboard_move_to_san(chessboard* cb, chessboard_movespec move, char* san);
+
 #endif
@@ -0,0 +1,618 @@
+#include "chessboard_bb.h"
+#include "fen.h"
+#include "pack.h"
+#include "arena.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <stdio.h> //For debugging
+
+/*
+This is a chessboard implementation using bitboards, as an alternative
+to the 0x88 board in chessboard_0x88.c.  It implements the whole
+chessboard API, so the two can be swapped at link time and compared on
+the same workloads (see the _bb targets in the makefile).
+
+Squares are the chessboard_square values themselves, so bit 0 is A8, bit
+7 is H8 and bit 63 is H1.  Moving "north" (towards rank 8) subtracts 8
+from a square and moving "east" (towards the H file) adds 1.
+
+Leaper attacks come from tables indexed by square, and slider attacks
+come from the magic bitboard tables in magic_bb.c.  Those tables are 
+filled using the classical ray approach kept here: for each direction
+we keep the ray of squares a slider would cover on an empty board, find
+the first blocker on it with a bit scan, and cut the ray off behind the
+blocker.  All of the tables are filled in by bb_init_tables the first
+time a board is allocated (by whichever thread gets there first, with
+pthread_once making any others wait).
+ */
+
+enum bb_direction {
+    BB_NORTH, BB_SOUTH, BB_EAST, BB_WEST,
+    BB_NORTHEAST, BB_NORTHWEST, BB_SOUTHEAST, BB_SOUTHWEST,
+    BB_MAX_DIRECTION,
+};
+
+const int direction_rank_steps[BB_MAX_DIRECTION] = {-1, 1, 0, 0, -1, -1, 1, 1};
+const int direction_file_steps[BB_MAX_DIRECTION] = {0, 0, 1, -1, 1, -1, 1, -1};
+// Directions that increase the square index have their nearest blocker
+// in the lowest set bit.  The others have it in the highest set bit.
+const bool direction_is_positive[BB_MAX_DIRECTION] =
+{false, true, true, false, false, false, true, true};
+
+uint64_t knight_attacks[CHESSBOARD_MAX_SQUARE];
+uint64_t king_attacks[CHESSBOARD_MAX_SQUARE];
+uint64_t pawn_attacks[2][CHESSBOARD_MAX_SQUARE];
+uint64_t rays[BB_MAX_DIRECTION][CHESSBOARD_MAX_SQUARE];
+
+// Castling rights that survive a move touching each square.
+uint32_t castle_masks[CHESSBOARD_MAX_SQUARE];
+
+pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+uint64_t _bb_step_bit(int rank, int file, int rank_step, int file_step);
+uint64_t _bb_ray_attacks(enum bb_direction direction, uint32_t square, uint64_t occupied);
+void _bb_get_castling_rook_squares(uint32_t king_to, uint32_t* rook_from, uint32_t* rook_to);
+void _bb_fill_tables();
+
+// Returns the bit for the square (rank + rank_step, file + file_step),
+// or 0 if that is off the board.  Ranks here count down from rank 8.
+uint64_t _bb_step_bit(int rank, int file, int rank_step, int file_step)
+{
+    rank += rank_step;
+    file += file_step;
+    if (rank < 0 || rank > 7 || file < 0 || file > 7) return 0;
+    return BB_BIT(rank * 8 + file);
+}
+
+void _bb_fill_tables()
+{
+    const int knight_rank_steps[8] = {-2, -2, -1, -1, 1, 1, 2, 2};
+    const int knight_file_steps[8] = {-1, 1, -2, 2, -2, 2, -1, 1};
+
+    for (int square = 0; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	int rank = square / 8;
+	int file = square % 8;
+
+	knight_attacks[square] = 0;
+	for (int i = 0; i < 8; i++)
+	{
+	    knight_attacks[square] |= _bb_step_bit(rank, file, knight_rank_steps[i], knight_file_steps[i]);
+	}
+
+	king_attacks[square] = 0;
+	for (int dir = 0; dir < BB_MAX_DIRECTION; dir++)
+	{
+	    king_attacks[square] |= _bb_step_bit(rank, file, direction_rank_steps[dir], direction_file_steps[dir]);
+
+	    rays[dir][square] = 0;
+	    for (int k = 1; k < 8; k++)
+	    {
+		uint64_t bit = _bb_step_bit(rank, file, k * direction_rank_steps[dir], k * direction_file_steps[dir]);
+		if (!bit) break;
+		rays[dir][square] |= bit;
+	    }
+	}
+
+	pawn_attacks[WHITE][square] = _bb_step_bit(rank, file, -1, -1) | _bb_step_bit(rank, file, -1, 1);
+	pawn_attacks[BLACK][square] = _bb_step_bit(rank, file, 1, -1) | _bb_step_bit(rank, file, 1, 1);
+
+	castle_masks[square] = BB_CASTLE_WHITE_SHORT | BB_CASTLE_WHITE_LONG |
+	    BB_CASTLE_BLACK_SHORT | BB_CASTLE_BLACK_LONG;
+    }
+    castle_masks[A1] &= ~BB_CASTLE_WHITE_LONG;
+    castle_masks[H1] &= ~BB_CASTLE_WHITE_SHORT;
+    castle_masks[E1] &= ~(BB_CASTLE_WHITE_SHORT | BB_CASTLE_WHITE_LONG);
+    castle_masks[A8] &= ~BB_CASTLE_BLACK_LONG;
+    castle_masks[H8] &= ~BB_CASTLE_BLACK_SHORT;
+    castle_masks[E8] &= ~(BB_CASTLE_BLACK_SHORT | BB_CASTLE_BLACK_LONG);
+
+    bb_init_magics();
+}
+
+void bb_init_tables()
+{
+    pthread_once(&tables_once, _bb_fill_tables);
+}
+
+int bb_lsb(uint64_t bits)
+{
+    assert(bits);
+    return __builtin_ctzll(bits);
+}
+
+int bb_msb(uint64_t bits)
+{
+    assert(bits);
+    return 63 - __builtin_clzll(bits);
+}
+
+// Sets up a newly allocated board as an empty board.
+void _bb_init_board(chessboard* cb)
+{
+    *cb = (chessboard){.to_move=CHESSBOARD_MAX_COLOR,
+		       .ep_square=CHESSBOARD_MAX_SQUARE,
+		       .fullmove_number=1};
+}
+
+chessboard* chessboard_allocate()
+{
+    chessboard* cb = (chessboard *)malloc(sizeof(chessboard));
+    if (cb)
+    {
+	bb_init_tables();
+	zobrist_init();
+	_bb_init_board(cb);
+    }
+    else
+    {
+	printf("DEBUG: Failed to allocate cb\n");
+    }
+    return cb;
+}
+
+void chessboard_free(chessboard* cb)
+{
+    assert(cb && "Tried to free null pointer to chessboard");
+    free(cb);
+}
+
+chessboard_arena* chessboard_arena_allocate(size_t capacity)
+{
+    bb_init_tables();
+    zobrist_init();
+    return arena_allocate(capacity, sizeof(chessboard));
+}
+
+bool chessboard_allocate_many(chessboard_arena* arena, size_t count, chessboard** boards)
+{
+    unsigned char* first = (unsigned char *)arena_take(arena, count);
+    if (!first) return false;
+    for (size_t i = 0; i < count; i++)
+    {
+	boards[i] = (chessboard *)(first + i * arena->stride);
+	_bb_init_board(boards[i]);
+    }
+    return true;
+}
+
+void chessboard_initialize_board(chessboard* cb)
+{
+    const chessboard_piecetype back_rank[8] =
+	{ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+
+    *cb = (chessboard){.to_move=WHITE,
+		       .castle=(BB_CASTLE_WHITE_SHORT | BB_CASTLE_WHITE_LONG |
+				BB_CASTLE_BLACK_SHORT | BB_CASTLE_BLACK_LONG),
+		       .ep_square=CHESSBOARD_MAX_SQUARE,
+		       .fullmove_number=1};
+    for (int file = 0; file < 8; file++)
+    {
+	bb_set_square(cb, A8 + file, back_rank[file], BLACK);
+	bb_set_square(cb, A7 + file, PAWN, BLACK);
+	bb_set_square(cb, A2 + file, PAWN, WHITE);
+	bb_set_square(cb, A1 + file, back_rank[file], WHITE);
+    }
+    cb->hash = bb_compute_hash(cb);
+}
+
+// Copies the pieces and state in and out of the mailbox that FEN and
+// packed positions share (see fen.h).
+void bb_set_position(chessboard* cb, struct fen_position* position)
+{
+    *cb = (chessboard){.to_move=position->to_move,
+		       .castle=position->castle,
+		       .ep_square=position->ep_square,
+		       .halfmove_clock=position->halfmove_clock,
+		       .fullmove_number=position->fullmove_number};
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	chessboard_piecetype type = position->types[square];
+	if (type == EMPTY) continue;
+	chessboard_color color = position->colors[square];
+	cb->pieces[color][type] |= BB_BIT(square);
+	cb->occupied[color] |= BB_BIT(square);
+    }
+    cb->all = cb->occupied[WHITE] | cb->occupied[BLACK];
+    cb->hash = bb_compute_hash(cb);
+}
+
+void bb_get_position(chessboard* cb, struct fen_position* position)
+{
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	position->types[square] = EMPTY;
+	position->colors[square] = CHESSBOARD_MAX_COLOR;
+    }
+    for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+	{
+	    for (uint64_t bits = cb->pieces[color][type]; bits; bits &= bits - 1)
+	    {
+		int square = bb_lsb(bits);
+		position->types[square] = (chessboard_piecetype)type;
+		position->colors[square] = (chessboard_color)color;
+	    }
+	}
+    }
+    position->to_move = cb->to_move;
+    position->castle = cb->castle;
+    position->ep_square = cb->ep_square;
+    position->halfmove_clock = cb->halfmove_clock;
+    position->fullmove_number = cb->fullmove_number;
+}
+
+bool chessboard_set_fen(chessboard* cb, const char* fen)
+{
+    struct fen_position position;
+
+    if (!fen_parse(fen, &position)) return false;
+    bb_set_position(cb, &position);
+    return true;
+}
+
+void chessboard_get_fen(chessboard* cb, char* fen)
+{
+    struct fen_position position;
+
+    bb_get_position(cb, &position);
+    fen_format(&position, fen);
+}
+
+void chessboard_pack(chessboard* cb, chessboard_packed* packed)
+{
+    struct fen_position position;
+
+    bb_get_position(cb, &position);
+    pack_position(&position, packed);
+}
+
+bool chessboard_unpack(chessboard* cb, const chessboard_packed* packed)
+{
+    struct fen_position position;
+
+    if (!unpack_position(packed, &position)) return false;
+    bb_set_position(cb, &position);
+    return true;
+}
+
+bool chessboard_is_rank(char ch)
+{
+    return (ch >= '1') && (ch <= '8');
+}
+
+bool chessboard_is_file(char ch)
+{
+    return (ch >= 'a') && (ch <= 'h');
+}
+
+bool chessboard_is_piece(char ch)
+{
+    return (ch == 'K') || (ch == 'Q') || (ch == 'R') || (ch == 'N') || (ch == 'B');
+}
+
+chessboard_color chessboard_get_current_player(chessboard *cb)
+{
+    return cb->to_move;
+}
+
+void chessboard_switch_current_player(chessboard *cb)
+{
+    // WARNING: Like the 0x88 version, this relies on WHITE and BLACK
+    // being 0 and 1.
+    cb->to_move = !(cb->to_move);
+    cb->hash ^= zobrist_black_to_move;
+}
+
+uint64_t chessboard_get_hash(chessboard* cb)
+{
+    return cb->hash;
+}
+
+// The part of the hash that comes from castling rights and en passant.
+uint64_t bb_state_key(chessboard* cb)
+{
+    uint64_t key = zobrist_castle[cb->castle];
+    if (cb->ep_square != CHESSBOARD_MAX_SQUARE) key ^= zobrist_ep_file[cb->ep_square % 8];
+    return key;
+}
+
+// Computes the hash from scratch, rather than incrementally.
+uint64_t bb_compute_hash(chessboard* cb)
+{
+    uint64_t hash = bb_state_key(cb);
+    if (cb->to_move == BLACK) hash ^= zobrist_black_to_move;
+    for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+	{
+	    for (uint64_t bits = cb->pieces[color][type]; bits; bits &= bits - 1)
+	    {
+		hash ^= zobrist_pieces[color][type][bb_lsb(bits)];
+	    }
+	}
+    }
+    return hash;
+}
+
+chessboard_color chessboard_get_color(chessboard* cb, chessboard_square square)
+{
+    if (cb->occupied[WHITE] & BB_BIT(square)) return WHITE;
+    if (cb->occupied[BLACK] & BB_BIT(square)) return BLACK;
+    return CHESSBOARD_MAX_COLOR;
+}
+
+chessboard_piecetype chessboard_get_piecetype(chessboard* cb, chessboard_square square)
+{
+    chessboard_color color = chessboard_get_color(cb, square);
+    return (color == CHESSBOARD_MAX_COLOR) ? EMPTY : bb_get_piecetype(cb, square, color);
+}
+
+// Finds the type of the piece of the given color on square, or EMPTY.
+chessboard_piecetype bb_get_piecetype(chessboard* cb, uint32_t square, chessboard_color color)
+{
+    uint64_t bit = BB_BIT(square);
+    for (chessboard_piecetype type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+    {
+	if (cb->pieces[color][type] & bit) return type;
+    }
+    return EMPTY;
+}
+
+void bb_set_square(chessboard* cb, uint32_t square, chessboard_piecetype type, chessboard_color color)
+{
+    bb_clear_square(cb, square);
+    cb->hash ^= zobrist_pieces[color][type][square];
+    cb->pieces[color][type] |= BB_BIT(square);
+    cb->occupied[color] |= BB_BIT(square);
+    cb->all |= BB_BIT(square);
+}
+
+void bb_clear_square(chessboard* cb, uint32_t square)
+{
+    uint64_t keep = ~BB_BIT(square);
+    for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+	{
+	    if (cb->pieces[color][type] & ~keep) cb->hash ^= zobrist_pieces[color][type][square];
+	    cb->pieces[color][type] &= keep;
+	}
+	cb->occupied[color] &= keep;
+    }
+    cb->all &= keep;
+}
+
+uint64_t _bb_ray_attacks(enum bb_direction direction, uint32_t square, uint64_t occupied)
+{
+    uint64_t attacks = rays[direction][square];
+    uint64_t blockers = attacks & occupied;
+    if (blockers)
+    {
+	int blocker = direction_is_positive[direction] ? bb_lsb(blockers) : bb_msb(blockers);
+	attacks ^= rays[direction][blocker];
+    }
+    return attacks;
+}
+
+uint64_t bb_ray_bishop_attacks(uint32_t square, uint64_t occupied)
+{
+    return _bb_ray_attacks(BB_NORTHEAST, square, occupied) |
+	_bb_ray_attacks(BB_NORTHWEST, square, occupied) |
+	_bb_ray_attacks(BB_SOUTHEAST, square, occupied) |
+	_bb_ray_attacks(BB_SOUTHWEST, square, occupied);
+}
+
+uint64_t bb_ray_rook_attacks(uint32_t square, uint64_t occupied)
+{
+    return _bb_ray_attacks(BB_NORTH, square, occupied) |
+	_bb_ray_attacks(BB_SOUTH, square, occupied) |
+	_bb_ray_attacks(BB_EAST, square, occupied) |
+	_bb_ray_attacks(BB_WEST, square, occupied);
+}
+
+/*
+Rather than looping over the attackers, we look outwards from the
+square: a piece attacks the square exactly when a piece of the same type
+on the square would attack it.  (Pawns are the exception, since they
+attack in one direction only, so we use the other color's pawn table.)
+ */
+bool bb_is_square_attacked(chessboard* cb, uint32_t square, chessboard_color attacker)
+{
+    uint64_t* pieces = cb->pieces[attacker];
+    return (pawn_attacks[!attacker][square] & pieces[PAWN]) ||
+	(knight_attacks[square] & pieces[KNIGHT]) ||
+	(king_attacks[square] & pieces[KING]) ||
+	(bb_bishop_attacks(square, cb->all) & (pieces[BISHOP] | pieces[QUEEN])) ||
+	(bb_rook_attacks(square, cb->all) & (pieces[ROOK] | pieces[QUEEN]));
+}
+
+/*
+bb_is_attacked_after does the same test for the position after the
+player to move plays "move", without playing it.  The moved piece (and
+the castling rook) are moved in copies of the attacker's bitboards and
+the occupancy, and a captured piece is left out of them.
+ */
+bool bb_is_attacked_after(chessboard* cb, struct bb_move* move, uint32_t square, chessboard_color attacker)
+{
+    uint64_t from_bit = BB_BIT(move->from);
+    uint64_t to_bit = BB_BIT(move->to);
+    uint64_t captured = to_bit;
+    if (move->flags & BB_FLAG_EN_PASSANT)
+    {
+	captured = (cb->to_move == WHITE) ? (to_bit << 8) : (to_bit >> 8);
+    }
+    uint64_t all = (cb->all & ~from_bit & ~captured) | to_bit;
+
+    uint64_t pieces[CHESSBOARD_MAX_PIECETYPE];
+    for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+    {
+	pieces[type] = cb->pieces[attacker][type];
+    }
+    if (attacker == cb->to_move)
+    {
+	pieces[move->piece] &= ~from_bit;
+	pieces[move->promotion != EMPTY ? move->promotion : move->piece] |= to_bit;
+	if (move->flags & BB_FLAG_CASTLE)
+	{
+	    uint32_t rook_from, rook_to;
+	    _bb_get_castling_rook_squares(move->to, &rook_from, &rook_to);
+	    pieces[ROOK] ^= BB_BIT(rook_from) | BB_BIT(rook_to);
+	    all ^= BB_BIT(rook_from) | BB_BIT(rook_to);
+	}
+    }
+    else
+    {
+	for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++) pieces[type] &= ~captured;
+    }
+
+    return (pawn_attacks[!attacker][square] & pieces[PAWN]) ||
+	(knight_attacks[square] & pieces[KNIGHT]) ||
+	(king_attacks[square] & pieces[KING]) ||
+	(bb_bishop_attacks(square, all) & (pieces[BISHOP] | pieces[QUEEN])) ||
+	(bb_rook_attacks(square, all) & (pieces[ROOK] | pieces[QUEEN]));
+}
+
+bool bb_is_player_in_check(chessboard* cb, chessboard_color player)
+{
+    assert(cb->pieces[player][KING] && "No king on board");
+    return bb_is_square_attacked(cb, bb_lsb(cb->pieces[player][KING]), !player);
+}
+
+void _bb_get_castling_rook_squares(uint32_t king_to, uint32_t* rook_from, uint32_t* rook_to)
+{
+    switch (king_to)
+    {
+    case G1:
+    case G8:
+	*rook_from = king_to + 1;
+	*rook_to = king_to - 1;
+	break;
+    case C1:
+    case C8:
+	*rook_from = king_to - 2;
+	*rook_to = king_to + 1;
+	break;
+    default:
+	assert(false && "Invalid castle move attempted");
+	break;
+    }
+}
+
+/*
+bb_make_move plays a pseudo-legal move and passes the turn to the other
+player.  bb_unmake_move takes it back, using the undo record filled in
+by bb_make_move.
+ */
+void bb_make_move(chessboard* cb, struct bb_move* move, struct bb_undo* undo)
+{
+    chessboard_color color = cb->to_move;
+    chessboard_color them = !color;
+    uint64_t from_bit = BB_BIT(move->from);
+    uint64_t to_bit = BB_BIT(move->to);
+
+    undo->castle = cb->castle;
+    undo->ep_square = cb->ep_square;
+    undo->halfmove_clock = cb->halfmove_clock;
+    undo->captured = EMPTY;
+    undo->hash = cb->hash;
+
+    if (move->flags & BB_FLAG_EN_PASSANT)
+    {
+	// The captured pawn is one square behind the to square.
+	uint64_t captured_bit = (color == WHITE) ? (to_bit << 8) : (to_bit >> 8);
+	cb->pieces[them][PAWN] ^= captured_bit;
+	cb->occupied[them] ^= captured_bit;
+	cb->hash ^= zobrist_pieces[them][PAWN][bb_lsb(captured_bit)];
+	undo->captured = PAWN;
+    }
+    else if (cb->occupied[them] & to_bit)
+    {
+	undo->captured = bb_get_piecetype(cb, move->to, them);
+	cb->pieces[them][undo->captured] ^= to_bit;
+	cb->occupied[them] ^= to_bit;
+	cb->hash ^= zobrist_pieces[them][undo->captured][move->to];
+    }
+
+    cb->pieces[color][move->piece] ^= from_bit | to_bit;
+    cb->occupied[color] ^= from_bit | to_bit;
+    cb->hash ^= zobrist_pieces[color][move->piece][move->from] ^
+	zobrist_pieces[color][move->piece][move->to];
+    if (move->promotion != EMPTY)
+    {
+	cb->pieces[color][PAWN] ^= to_bit;
+	cb->pieces[color][move->promotion] |= to_bit;
+	cb->hash ^= zobrist_pieces[color][PAWN][move->to] ^
+	    zobrist_pieces[color][move->promotion][move->to];
+    }
+    if (move->flags & BB_FLAG_CASTLE)
+    {
+	uint32_t rook_from, rook_to;
+	_bb_get_castling_rook_squares(move->to, &rook_from, &rook_to);
+	uint64_t rook_bits = BB_BIT(rook_from) | BB_BIT(rook_to);
+	cb->pieces[color][ROOK] ^= rook_bits;
+	cb->occupied[color] ^= rook_bits;
+	cb->hash ^= zobrist_pieces[color][ROOK][rook_from] ^
+	    zobrist_pieces[color][ROOK][rook_to];
+    }
+    cb->all = cb->occupied[WHITE] | cb->occupied[BLACK];
+
+    cb->hash ^= bb_state_key(cb);
+    cb->castle &= castle_masks[move->from] & castle_masks[move->to];
+    cb->ep_square = (move->flags & BB_FLAG_DOUBLE_PUSH) ?
+	(move->from + move->to) / 2 : CHESSBOARD_MAX_SQUARE;
+    cb->hash ^= bb_state_key(cb) ^ zobrist_black_to_move;
+    cb->halfmove_clock = (move->piece == PAWN || undo->captured != EMPTY) ?
+	0 : cb->halfmove_clock + 1;
+    if (color == BLACK) cb->fullmove_number++;
+    cb->to_move = them;
+}
+
+void bb_unmake_move(chessboard* cb, struct bb_move* move, struct bb_undo* undo)
+{
+    chessboard_color them = cb->to_move;
+    chessboard_color color = !them;
+    uint64_t from_bit = BB_BIT(move->from);
+    uint64_t to_bit = BB_BIT(move->to);
+
+    // Everything in the hash goes back to what it was, so it's simpler
+    // to restore it than to undo each change.
+    cb->hash = undo->hash;
+    cb->to_move = color;
+    if (move->promotion != EMPTY)
+    {
+	cb->pieces[color][move->promotion] ^= to_bit;
+	cb->pieces[color][PAWN] ^= to_bit;
+    }
+    cb->pieces[color][move->piece] ^= from_bit | to_bit;
+    cb->occupied[color] ^= from_bit | to_bit;
+    if (move->flags & BB_FLAG_CASTLE)
+    {
+	uint32_t rook_from, rook_to;
+	_bb_get_castling_rook_squares(move->to, &rook_from, &rook_to);
+	uint64_t rook_bits = BB_BIT(rook_from) | BB_BIT(rook_to);
+	cb->pieces[color][ROOK] ^= rook_bits;
+	cb->occupied[color] ^= rook_bits;
+    }
+
+    if (undo->captured != EMPTY)
+    {
+	uint64_t captured_bit = to_bit;
+	if (move->flags & BB_FLAG_EN_PASSANT)
+	{
+	    captured_bit = (color == WHITE) ? (to_bit << 8) : (to_bit >> 8);
+	}
+	cb->pieces[them][undo->captured] |= captured_bit;
+	cb->occupied[them] |= captured_bit;
+    }
+    cb->all = cb->occupied[WHITE] | cb->occupied[BLACK];
+
+    cb->castle = undo->castle;
+    cb->ep_square = undo->ep_square;
+    cb->halfmove_clock = undo->halfmove_clock;
+    if (color == BLACK) cb->fullmove_number--;
+}
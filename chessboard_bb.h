@@ -0,0 +1,139 @@
+#ifndef CHESSBOARD_BB_H
+#define CHESSBOARD_BB_H
+
+#include "chessboard_api.h"
+#include "zobrist.h"
+#include "fen.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Bitboard chessboard.  Each bit of a uint64_t stands for one square,
+using the chessboard_square numbering (bit 0 is A8, bit 63 is H1), so
+API squares never need translating.  The board keeps one bitboard per
+piece type and color (the EMPTY entries are unused), plus the occupancy
+of each color and of the whole board.
+ */
+struct chessboard {
+    uint64_t pieces[2][CHESSBOARD_MAX_PIECETYPE];
+    uint64_t occupied[2];
+    uint64_t all;
+    chessboard_color to_move;
+    // BB_CASTLE_ bits
+    uint32_t castle;
+    // Square a pawn skipped over with a double step on the last move,
+    // or CHESSBOARD_MAX_SQUARE if there is no en passant capture.
+    uint32_t ep_square;
+    uint32_t halfmove_clock;
+    uint32_t fullmove_number;
+    // Zobrist hash of the position (see zobrist.h)
+    uint64_t hash;
+};
+
+// These match the ZOBRIST_ castling bits, so cb->castle can index
+// zobrist_castle directly.
+#define BB_CASTLE_WHITE_SHORT ZOBRIST_WHITE_SHORT
+#define BB_CASTLE_WHITE_LONG ZOBRIST_WHITE_LONG
+#define BB_CASTLE_BLACK_SHORT ZOBRIST_BLACK_SHORT
+#define BB_CASTLE_BLACK_LONG ZOBRIST_BLACK_LONG
+
+#define BB_FILE_A 0x0101010101010101ULL
+#define BB_FILE_H 0x8080808080808080ULL
+#define BB_RANK_8 0x00000000000000FFULL
+#define BB_RANK_6 0x0000000000FF0000ULL
+#define BB_RANK_3 0x0000FF0000000000ULL
+#define BB_RANK_1 0xFF00000000000000ULL
+
+#define BB_BIT(square) (1ULL << (square))
+
+#define BB_FLAG_EN_PASSANT 0x1
+#define BB_FLAG_CASTLE 0x2
+#define BB_FLAG_DOUBLE_PUSH 0x4
+
+struct bb_move {
+    uint8_t from;
+    uint8_t to;
+    // The type of the moving piece, before any promotion
+    uint8_t piece;
+    // EMPTY unless the move is a pawn promotion
+    uint8_t promotion;
+    uint8_t flags;
+};
+
+struct bb_undo {
+    uint64_t hash;
+    uint8_t castle;
+    uint8_t ep_square;
+    uint8_t captured;
+    uint32_t halfmove_clock;
+};
+
+#define BB_MAX_MOVES 256
+
+struct bb_move_list {
+    struct bb_move moves[BB_MAX_MOVES];
+    int count;
+};
+
+extern uint64_t knight_attacks[CHESSBOARD_MAX_SQUARE];
+extern uint64_t king_attacks[CHESSBOARD_MAX_SQUARE];
+extern uint64_t pawn_attacks[2][CHESSBOARD_MAX_SQUARE];
+
+void bb_init_tables();
+
+int bb_lsb(uint64_t bits);
+int bb_msb(uint64_t bits);
+
+void bb_set_position(chessboard* cb, struct fen_position* position);
+void bb_get_position(chessboard* cb, struct fen_position* position);
+void _bb_init_board(chessboard* cb);
+
+void bb_set_square(chessboard* cb, uint32_t square, chessboard_piecetype type, chessboard_color color);
+void bb_clear_square(chessboard* cb, uint32_t square);
+chessboard_piecetype bb_get_piecetype(chessboard* cb, uint32_t square, chessboard_color color);
+
+uint64_t bb_ray_bishop_attacks(uint32_t square, uint64_t occupied);
+uint64_t bb_ray_rook_attacks(uint32_t square, uint64_t occupied);
+
+/*
+Magic bitboards (see magic_bb.c).  For each square, "mask" holds the
+squares whose occupancy can change a slider's attacks and "attacks"
+points to that square's part of the attack table.  The index into it
+is either the masked occupancy times "magic", shifted right by "shift",
+or the masked occupancy packed together with the BMI2 pext instruction
+when the processor has it.
+ */
+struct bb_magic {
+    uint64_t mask;
+    uint64_t magic;
+    uint64_t* attacks;
+    uint32_t shift;
+};
+
+#define BB_BISHOP_TABLE_SIZE 5248
+#define BB_ROOK_TABLE_SIZE 102400
+
+void bb_init_magics();
+uint64_t bb_bishop_attacks(uint32_t square, uint64_t occupied);
+uint64_t bb_rook_attacks(uint32_t square, uint64_t occupied);
+uint64_t bb_state_key(chessboard* cb);
+uint64_t bb_compute_hash(chessboard* cb);
+
+bool bb_is_square_attacked(chessboard* cb, uint32_t square, chessboard_color attacker);
+bool bb_is_player_in_check(chessboard* cb, chessboard_color player);
+bool bb_is_attacked_after(chessboard* cb, struct bb_move* move, uint32_t square, chessboard_color attacker);
+
+void bb_make_move(chessboard* cb, struct bb_move* move, struct bb_undo* undo);
+void bb_unmake_move(chessboard* cb, struct bb_move* move, struct bb_undo* undo);
+
+void bb_generate_pseudo_moves(chessboard* cb, struct bb_move_list* list);
+void bb_generate_moves(chessboard* cb, struct bb_move_list* list);
+bool bb_has_legal_move(chessboard* cb);
+uint64_t bb_perft(chessboard* cb, int depth);
+uint64_t bb_perft_hashed(chessboard* cb, int depth, struct perft_table* table);
+
+bool bb_find_san_move(chessboard* cb, const char* move_str, size_t len,
+		      struct bb_move_list* legal, struct bb_move* move);
+
+#endif
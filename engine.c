@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chessboard_api.h"
+#include "search.h"
+#include "game_88.h"
+
+/*
+Engine driver
+-----------------------------------------------------------------------
+Picks a move for the player to move and prints it, along with a line
+per search iteration.  Usage:
+
+    engine.exe [-depth d] [-nodes n] [-time seconds] [-hash mb] [-threads n] [move ...]
+
+The position is the starting position, followed by any moves given in
+standard algebraic notation.  Without any limits the search stops at
+depth 6.  -hash sets the size of the transposition table (0 for none),
+and -threads the number of search threads sharing it.
+ */
+
+int main(int argc, char* argv[])
+{
+    struct search_limits limits = {0};
+    size_t hash_mb = 16;
+    int num_threads = 1;
+    int arg = 1;
+
+    for ( ; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+	if (!strcmp(argv[arg], "-depth")) limits.depth = atoi(argv[arg + 1]);
+	else if (!strcmp(argv[arg], "-nodes")) limits.nodes = (uint64_t)atoll(argv[arg + 1]);
+	else if (!strcmp(argv[arg], "-time")) limits.seconds = atof(argv[arg + 1]);
+	else if (!strcmp(argv[arg], "-hash")) hash_mb = (size_t)atoi(argv[arg + 1]);
+	else if (!strcmp(argv[arg], "-threads")) num_threads = atoi(argv[arg + 1]);
+	else break;
+    }
+    if (arg < argc && argv[arg][0] == '-')
+    {
+	printf("Usage: %s [-depth d] [-nodes n] [-time seconds] [-hash mb] [-threads n] [move ...]\n", argv[0]);
+	return -1;
+    }
+    if (!limits.depth && !limits.nodes && limits.seconds <= 0) limits.depth = 6;
+
+    // The game needs a position for the start and one for each move.
+    c88_game* game = c88_game_allocate((uint32_t)(argc - arg + 1));
+    if (!game) return -2;
+    uint32_t pos = C88_GAME_ROOT;
+    for ( ; arg < argc; arg++)
+    {
+	pos = c88_game_play_san(game, pos, argv[arg], strlen(argv[arg]));
+	if (pos == C88_NO_POSITION)
+	{
+	    printf("Illegal move: %s\n", argv[arg]);
+	    c88_game_free(game);
+	    return -1;
+	}
+    }
+    chessboard* cb = &game->pos_tree[pos].board;
+
+    struct ttable* tt = NULL;
+    if (hash_mb > 0)
+    {
+	tt = tt_allocate(hash_mb);
+	if (!tt)
+	{
+	    c88_game_free(game);
+	    return -2;
+	}
+    }
+
+    struct search_result result;
+    search_iterate(cb, tt, &limits, num_threads, true, &result);
+    if (result.pv_length > 0)
+    {
+	char move_str[6];
+	search_move_to_str(&result.pv[0], move_str);
+	printf("\nBest move: %s\n", move_str);
+    }
+    else
+    {
+	printf("\nNo legal moves\n");
+    }
+
+    if (tt) tt_free(tt);
+    c88_game_free(game);
+    return 0;
+}
@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "chessboard_api.h"
+#include "search.h"
+
+/*
+EPD test suite runner
+-----------------------------------------------------------------------
+Searches every position in an EPD file and reports how many the engine
+solved, how long it took to find the solutions and how fast it searched.
+Usage:
+
+    epdrun.exe [-time seconds] [-nodes n] [-depth d] [-hash mb] [-threads n] [-v] file.epd
+
+Each line of the file is the first four fields of a FEN, followed by
+operations like
+
+    bm Qxf7+ Rd8; am Nc3; id "WAC.001";
+
+A position is solved if the search's best move is one of its "bm"
+moves (if it has any) and none of its "am" moves.  Lines without either
+are skipped, as are lines whose position chessboard_set_fen rejects, so
+one bad line doesn't spoil the run.  Moves are compared as SAN,
+ignoring check marks and annotations.
+
+Every position gets its own search with the same limits (one second
+each if none are given) and a cleared transposition table, so a
+position's result doesn't depend on which positions came before it or
+on how many threads there are.  Each worker thread has its own board
+and table, and repeatedly claims the next unsearched position.  The
+time to solution is when the search settled on a solving move for
+good: the time of the first iteration from which every iteration picked
+a solving move.  -v prints every position's result, rather than just
+the failures.
+ */
+
+#define EPD_MAX_MOVES 8
+#define EPD_MAX_ID 64
+
+struct epd_position {
+    // The line from the file, null terminated.
+    char* line;
+    int line_number;
+    char fen[CHESSBOARD_MAX_FEN];
+    char id[EPD_MAX_ID];
+    char best[EPD_MAX_MOVES][CHESSBOARD_MAX_SAN];
+    int num_best;
+    char avoid[EPD_MAX_MOVES][CHESSBOARD_MAX_SAN];
+    int num_avoid;
+
+    bool searched;
+    bool solved;
+    char move[CHESSBOARD_MAX_SAN];
+    // Only meaningful if solved.
+    double solve_seconds;
+    int depth;
+    uint64_t nodes;
+    double seconds;
+};
+
+struct epd_suite {
+    struct epd_position* positions;
+    size_t num_positions;
+    size_t next_position;
+    struct search_limits limits;
+};
+
+struct epd_worker {
+    pthread_t thread;
+    struct epd_suite* suite;
+    chessboard* cb;
+    struct ttable* tt;
+    // The position being searched, and whether the last completed
+    // iteration solved it.
+    struct epd_position* position;
+    bool solving;
+};
+
+double _elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Copies a move in SAN without any check mark or annotation, and with
+// castling spelled with O's, so that "0-0+" and "O-O" compare equal.
+void _copy_san(char* dst, const char* src, size_t len)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < len && n < CHESSBOARD_MAX_SAN - 1; i++)
+    {
+	if (strchr("+#!?", src[i])) break;
+	dst[n++] = (src[i] == '0') ? 'O' : src[i];
+    }
+    dst[n] = '\0';
+}
+
+bool _is_space(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+/*
+Reads the FEN fields and the bm, am and id operations out of the
+position's line.  Other operations are ignored.  Returns false if the
+line doesn't have a whole FEN, or the FEN doesn't load.
+ */
+bool _parse_position(chessboard* cb, struct epd_position* position)
+{
+    const char* p = position->line;
+    size_t fen_len = 0;
+
+    for (int field = 0; field < 4; field++)
+    {
+	while (_is_space(*p)) p++;
+	if (!*p) return false;
+	if (field > 0 && fen_len < CHESSBOARD_MAX_FEN - 1) position->fen[fen_len++] = ' ';
+	while (*p && !_is_space(*p))
+	{
+	    if (fen_len < CHESSBOARD_MAX_FEN - 1) position->fen[fen_len++] = *p;
+	    p++;
+	}
+    }
+    position->fen[fen_len] = '\0';
+    if (!chessboard_set_fen(cb, position->fen)) return false;
+
+    while (*p)
+    {
+	while (_is_space(*p) || *p == ';') p++;
+	const char* opcode = p;
+	while (*p && !_is_space(*p) && *p != ';') p++;
+	size_t opcode_len = (size_t)(p - opcode);
+	if (!opcode_len) break;
+
+	while (*p && *p != ';')
+	{
+	    while (_is_space(*p)) p++;
+	    if (!*p || *p == ';') break;
+	    const char* operand = p;
+	    if (*p == '"')
+	    {
+		operand = ++p;
+		while (*p && *p != '"') p++;
+	    }
+	    else
+	    {
+		while (*p && !_is_space(*p) && *p != ';') p++;
+	    }
+	    size_t operand_len = (size_t)(p - operand);
+	    if (*p == '"') p++;
+
+	    if (opcode_len == 2 && !strncmp(opcode, "bm", 2) && position->num_best < EPD_MAX_MOVES)
+	    {
+		_copy_san(position->best[position->num_best++], operand, operand_len);
+	    }
+	    else if (opcode_len == 2 && !strncmp(opcode, "am", 2) && position->num_avoid < EPD_MAX_MOVES)
+	    {
+		_copy_san(position->avoid[position->num_avoid++], operand, operand_len);
+	    }
+	    else if (opcode_len == 2 && !strncmp(opcode, "id", 2))
+	    {
+		if (operand_len > EPD_MAX_ID - 1) operand_len = EPD_MAX_ID - 1;
+		memcpy(position->id, operand, operand_len);
+		position->id[operand_len] = '\0';
+	    }
+	}
+    }
+    return position->num_best > 0 || position->num_avoid > 0;
+}
+
+bool _is_solution(struct epd_position* position, const char* move)
+{
+    for (int i = 0; i < position->num_avoid; i++)
+    {
+	if (!strcmp(move, position->avoid[i])) return false;
+    }
+    if (position->num_best == 0) return true;
+    for (int i = 0; i < position->num_best; i++)
+    {
+	if (!strcmp(move, position->best[i])) return true;
+    }
+    return false;
+}
+
+// Writes the first move of the result's PV as SAN, or "none".
+void _result_to_san(chessboard* cb, struct search_result* result, char* san)
+{
+    char full[CHESSBOARD_MAX_SAN];
+
+    strcpy(san, "none");
+    if (result->pv_length == 0) return;
+    struct _move* move = &result->pv[0];
+    chessboard_movespec spec = {.from=cb88_get_chessboard_square(move->from),
+				.to=cb88_get_chessboard_square(move->to),
+				.promotion=move->promotion};
+    if (chessboard_move_to_san(cb, spec, full)) _copy_san(san, full, strlen(full));
+}
+
+void _on_iteration(struct search_result* result, void* data)
+{
+    struct epd_worker* worker = (struct epd_worker *)data;
+    struct epd_position* position = worker->position;
+    char move[CHESSBOARD_MAX_SAN];
+
+    _result_to_san(worker->cb, result, move);
+    bool solved = _is_solution(position, move);
+    if (solved && !worker->solving) position->solve_seconds = result->seconds;
+    worker->solving = solved;
+}
+
+void* _epd_thread_main(void* arg)
+{
+    struct epd_worker* worker = (struct epd_worker *)arg;
+    struct epd_suite* suite = worker->suite;
+    struct search_limits limits = suite->limits;
+    struct search_result result;
+
+    limits.on_iteration = _on_iteration;
+    limits.data = worker;
+    while (true)
+    {
+	size_t i = __atomic_fetch_add(&suite->next_position, 1, __ATOMIC_RELAXED);
+	if (i >= suite->num_positions) break;
+	struct epd_position* position = &suite->positions[i];
+	if (!_parse_position(worker->cb, position)) continue;
+
+	worker->position = position;
+	worker->solving = false;
+	if (worker->tt) tt_clear(worker->tt);
+	search_iterate(worker->cb, worker->tt, &limits, 1, false, &result);
+
+	_result_to_san(worker->cb, &result, position->move);
+	position->searched = true;
+	position->solved = _is_solution(position, position->move);
+	position->depth = result.depth;
+	position->nodes = result.nodes;
+	position->seconds = result.seconds;
+    }
+    return NULL;
+}
+
+// Reads the whole file and cuts it into null terminated lines, skipping
+// blank ones.  Returns false if the file can't be read.
+bool _load_suite(const char* filename, struct epd_suite* suite, char** text)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    *text = (char *)malloc((size_t)size + 1);
+    if (size < 0 || !*text || fread(*text, 1, (size_t)size, file) != (size_t)size)
+    {
+	fclose(file);
+	return false;
+    }
+    fclose(file);
+    (*text)[size] = '\0';
+
+    size_t max_lines = 1;
+    for (long i = 0; i < size; i++)
+    {
+	if ((*text)[i] == '\n') max_lines++;
+    }
+    suite->positions = (struct epd_position *)calloc(max_lines, sizeof(struct epd_position));
+    if (!suite->positions) return false;
+
+    char* line = *text;
+    int line_number = 1;
+    while (line)
+    {
+	char* end = strchr(line, '\n');
+	if (end) *end = '\0';
+	const char* p = line;
+	while (_is_space(*p)) p++;
+	if (*p)
+	{
+	    suite->positions[suite->num_positions].line = line;
+	    suite->positions[suite->num_positions].line_number = line_number;
+	    suite->num_positions++;
+	}
+	line = end ? end + 1 : NULL;
+	line_number++;
+    }
+    return true;
+}
+
+void _print_position(struct epd_position* position)
+{
+    printf("%s %s: %s", position->solved ? "solved" : "FAILED",
+	   position->id[0] ? position->id : position->fen, position->move);
+    if (position->num_best > 0)
+    {
+	printf(", bm");
+	for (int i = 0; i < position->num_best; i++) printf(" %s", position->best[i]);
+    }
+    if (position->num_avoid > 0)
+    {
+	printf(", am");
+	for (int i = 0; i < position->num_avoid; i++) printf(" %s", position->avoid[i]);
+    }
+    printf(", depth %d, %llu nodes", position->depth, (unsigned long long)position->nodes);
+    if (position->solved) printf(", solved in %.3f s", position->solve_seconds);
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    struct epd_suite suite = {0};
+    size_t hash_mb = 16;
+    int num_threads = 1;
+    bool verbose = false;
+    int arg = 1;
+
+    for ( ; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+	if (!strcmp(argv[arg], "-v")) verbose = true;
+	else if (arg + 1 >= argc) break;
+	else if (!strcmp(argv[arg], "-time")) suite.limits.seconds = atof(argv[++arg]);
+	else if (!strcmp(argv[arg], "-nodes")) suite.limits.nodes = (uint64_t)atoll(argv[++arg]);
+	else if (!strcmp(argv[arg], "-depth")) suite.limits.depth = atoi(argv[++arg]);
+	else if (!strcmp(argv[arg], "-hash")) hash_mb = (size_t)atoi(argv[++arg]);
+	else if (!strcmp(argv[arg], "-threads")) num_threads = atoi(argv[++arg]);
+	else break;
+    }
+    if (arg != argc - 1 || num_threads < 1)
+    {
+	printf("Usage: %s [-time seconds] [-nodes n] [-depth d] [-hash mb] [-threads n] [-v] file.epd\n", argv[0]);
+	return -1;
+    }
+    if (!suite.limits.depth && !suite.limits.nodes && suite.limits.seconds <= 0) suite.limits.seconds = 1;
+
+    char* text = NULL;
+    if (!_load_suite(argv[arg], &suite, &text))
+    {
+	printf("Can't read %s\n", argv[arg]);
+	return -1;
+    }
+
+    // Boards come from one arena, which keeps each worker's board on its
+    // own cache lines.
+    struct epd_worker* workers = (struct epd_worker *)calloc(num_threads, sizeof(struct epd_worker));
+    chessboard** boards = (chessboard **)calloc(num_threads, sizeof(chessboard *));
+    chessboard_arena* arena = chessboard_arena_allocate(num_threads);
+    if (!workers || !boards || !arena || !chessboard_allocate_many(arena, num_threads, boards))
+    {
+	printf("DEBUG: Failed to allocate workers\n");
+	return -2;
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+	workers[i].suite = &suite;
+	workers[i].cb = boards[i];
+	if (hash_mb > 0 && !(workers[i].tt = tt_allocate(hash_mb))) return -2;
+    }
+
+    // If a thread fails to start, the ones that did (at least this one)
+    // still claim every position.
+    struct timespec start;
+    int num_started = 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 1; i < num_threads; i++)
+    {
+	if (pthread_create(&workers[i].thread, NULL, _epd_thread_main, &workers[i]))
+	{
+	    printf("DEBUG: Failed to start EPD thread %d\n", i);
+	    break;
+	}
+	num_started = i + 1;
+    }
+    _epd_thread_main(&workers[0]);
+    for (int i = 1; i < num_started; i++) pthread_join(workers[i].thread, NULL);
+    double seconds = _elapsed_seconds(&start);
+
+    size_t searched = 0, solved = 0;
+    uint64_t nodes = 0;
+    double solve_seconds = 0, search_seconds = 0;
+    for (size_t i = 0; i < suite.num_positions; i++)
+    {
+	struct epd_position* position = &suite.positions[i];
+	if (!position->searched)
+	{
+	    printf("Skipped line %d: bad position, or no bm or am\n", position->line_number);
+	    continue;
+	}
+	searched++;
+	nodes += position->nodes;
+	search_seconds += position->seconds;
+	if (position->solved)
+	{
+	    solved++;
+	    solve_seconds += position->solve_seconds;
+	}
+	if (verbose || !position->solved) _print_position(position);
+    }
+
+    printf("\nPositions: %zu\nSolved: %zu", searched, solved);
+    if (searched > 0) printf(" (%.1f%%)", 100.0 * (double)solved / (double)searched);
+    printf("\nTime to solution: %.3f s total", solve_seconds);
+    if (solved > 0) printf(", %.3f s average", solve_seconds / (double)solved);
+    printf("\nNodes: %llu, %.3f s", (unsigned long long)nodes, seconds);
+    if (seconds > 0) printf(", %.0f nps", (double)nodes / seconds);
+    if (search_seconds > 0) printf(" (%.0f nps per thread)", (double)nodes / search_seconds);
+    printf("\n");
+
+    for (int i = 0; i < num_threads; i++)
+    {
+	if (workers[i].tt) tt_free(workers[i].tt);
+    }
+    chessboard_arena_free(arena);
+    free(boards);
+    free(workers);
+    free(suite.positions);
+    free(text);
+    return 0;
+}
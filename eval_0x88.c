@@ -0,0 +1,158 @@
+#include "eval_0x88.h"
+#include "chessboard_0x88.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/*
+The piece-square tables are Tomasz Michniewski's "simplified evaluation
+function", with an extra endgame table for the king (which should hide
+in the middlegame but come out and fight once the queens are off).  They
+are written from white's side, laid out the way the board is printed:
+the first row is rank 8 and the last is rank 1.  Black's pieces use the
+same tables flipped top to bottom.
+ */
+
+int16_t cb88_eval_mg[2][CHESSBOARD_MAX_PIECETYPE][128];
+int16_t cb88_eval_eg[2][CHESSBOARD_MAX_PIECETYPE][128];
+
+// Knights and bishops count 1 toward the phase, rooks 2 and queens 4,
+// so the starting position has CB88_EVAL_MAX_PHASE.
+const int cb88_phase_weights[CHESSBOARD_MAX_PIECETYPE] = {0, 0, 1, 0, 1, 4, 2};
+
+const int mg_values[CHESSBOARD_MAX_PIECETYPE] = {0, 82, 337, 0, 365, 1025, 477};
+const int eg_values[CHESSBOARD_MAX_PIECETYPE] = {0, 94, 281, 0, 297, 936, 512};
+
+const int8_t pawn_table[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    10, 10, 20, 30, 30, 20, 10, 10,
+     5,  5, 10, 25, 25, 10,  5,  5,
+     0,  0,  0, 20, 20,  0,  0,  0,
+     5, -5,-10,  0,  0,-10, -5,  5,
+     5, 10, 10,-20,-20, 10, 10,  5,
+     0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+const int8_t knight_table[64] = {
+    -50,-40,-30,-30,-30,-30,-40,-50,
+    -40,-20,  0,  0,  0,  0,-20,-40,
+    -30,  0, 10, 15, 15, 10,  0,-30,
+    -30,  5, 15, 20, 20, 15,  5,-30,
+    -30,  0, 15, 20, 20, 15,  0,-30,
+    -30,  5, 10, 15, 15, 10,  5,-30,
+    -40,-20,  0,  5,  5,  0,-20,-40,
+    -50,-40,-30,-30,-30,-30,-40,-50,
+};
+
+const int8_t bishop_table[64] = {
+    -20,-10,-10,-10,-10,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5, 10, 10,  5,  0,-10,
+    -10,  5,  5, 10, 10,  5,  5,-10,
+    -10,  0, 10, 10, 10, 10,  0,-10,
+    -10, 10, 10, 10, 10, 10, 10,-10,
+    -10,  5,  0,  0,  0,  0,  5,-10,
+    -20,-10,-10,-10,-10,-10,-10,-20,
+};
+
+const int8_t rook_table[64] = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+      5, 10, 10, 10, 10, 10, 10,  5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+      0,  0,  0,  5,  5,  0,  0,  0,
+};
+
+const int8_t queen_table[64] = {
+    -20,-10,-10, -5, -5,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5,  5,  5,  5,  0,-10,
+     -5,  0,  5,  5,  5,  5,  0, -5,
+      0,  0,  5,  5,  5,  5,  0, -5,
+    -10,  5,  5,  5,  5,  5,  0,-10,
+    -10,  0,  5,  0,  0,  0,  0,-10,
+    -20,-10,-10, -5, -5,-10,-10,-20,
+};
+
+const int8_t king_mg_table[64] = {
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -20,-30,-30,-40,-40,-30,-30,-20,
+    -10,-20,-20,-20,-20,-20,-20,-10,
+     20, 20,  0,  0,  0,  0, 20, 20,
+     20, 30, 10,  0,  0, 10, 30, 20,
+};
+
+const int8_t king_eg_table[64] = {
+    -50,-40,-30,-20,-20,-30,-40,-50,
+    -30,-20,-10,  0,  0,-10,-20,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-30,  0,  0,  0,  0,-30,-30,
+    -50,-30,-30,-30,-30,-30,-30,-50,
+};
+
+pthread_once_t eval_once = PTHREAD_ONCE_INIT;
+
+void _cb88_eval_fill();
+
+void _cb88_eval_fill()
+{
+    const int8_t* mg_tables[CHESSBOARD_MAX_PIECETYPE] =
+	{0, pawn_table, knight_table, king_mg_table, bishop_table, queen_table, rook_table};
+    const int8_t* eg_tables[CHESSBOARD_MAX_PIECETYPE] =
+	{0, pawn_table, knight_table, king_eg_table, bishop_table, queen_table, rook_table};
+
+    for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+    {
+	for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+	{
+	    uint32_t index = cb88_get_square(square);
+	    // Black's view of the board is white's flipped top to bottom.
+	    int flipped = square ^ 56;
+	    cb88_eval_mg[WHITE][type][index] = mg_values[type] + mg_tables[type][square];
+	    cb88_eval_eg[WHITE][type][index] = eg_values[type] + eg_tables[type][square];
+	    cb88_eval_mg[BLACK][type][index] = -(mg_values[type] + mg_tables[type][flipped]);
+	    cb88_eval_eg[BLACK][type][index] = -(eg_values[type] + eg_tables[type][flipped]);
+	}
+    }
+}
+
+void cb88_eval_init()
+{
+    pthread_once(&eval_once, _cb88_eval_fill);
+}
+
+int cb88_evaluate(chessboard* cb)
+{
+    int phase = (cb->phase < CB88_EVAL_MAX_PHASE) ? cb->phase : CB88_EVAL_MAX_PHASE;
+    int score = (cb->eval_mg * phase + cb->eval_eg * (CB88_EVAL_MAX_PHASE - phase)) /
+	CB88_EVAL_MAX_PHASE;
+    return (cb->to_move == WHITE) ? score : -score;
+}
+
+void cb88_compute_eval(chessboard* cb, int32_t* mg, int32_t* eg, int32_t* phase)
+{
+    *mg = 0;
+    *eg = 0;
+    *phase = 0;
+    for (chessboard_color color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int i = 0; i < CB88_MAX_PIECES; i++)
+	{
+	    struct piece* piece = &cb->piecelist[color][i];
+	    if (piece->type == EMPTY) continue;
+	    *mg += cb88_eval_mg[color][piece->type][piece->square];
+	    *eg += cb88_eval_eg[color][piece->type][piece->square];
+	    *phase += cb88_phase_weights[piece->type];
+	}
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef EVAL_0X88_H
+#define EVAL_0X88_H
+
+#include "chessboard_api.h"
+#include <stdint.h>
+
+/*
+Evaluation for the 0x88 board.  The score is material plus a bonus or
+penalty for the square each piece stands on, with separate middlegame
+and endgame values that are blended by how much material is left (the
+"phase").  All three sums are kept in the chessboard and updated every
+time a piece is added, removed or moved, so evaluating a position is a
+few arithmetic operations no matter what is on the board.
+
+The tables are indexed by 0x88 square and already have the sign of the
+piece's color folded in (positive for white), so an update is a single
+add or subtract.  cb88_eval_init fills them the first time a board is
+allocated.  Like zobrist_init, it is safe to call from several threads
+at once.
+ */
+
+#define CB88_EVAL_MAX_PHASE 24
+
+extern int16_t cb88_eval_mg[2][CHESSBOARD_MAX_PIECETYPE][128];
+extern int16_t cb88_eval_eg[2][CHESSBOARD_MAX_PIECETYPE][128];
+extern const int cb88_phase_weights[CHESSBOARD_MAX_PIECETYPE];
+
+void cb88_eval_init();
+
+/*
+cb88_evaluate returns the score of the position in centipawns, from the
+point of view of the player to move.
+ */
+int cb88_evaluate(chessboard* cb);
+
+// Computes the incremental terms from scratch, for checking them.
+void cb88_compute_eval(chessboard* cb, int32_t* mg, int32_t* eg, int32_t* phase);
+
+#endif
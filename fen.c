@@ -0,0 +1,290 @@
+#include "fen.h"
+#include "zobrist.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+const char fen_piece_chars[CHESSBOARD_MAX_PIECETYPE] = {' ', 'p', 'n', 'k', 'b', 'q', 'r'};
+
+chessboard_piecetype _fen_piecetype(char ch);
+const char* _fen_parse_number(const char* str, uint32_t* number);
+char* _fen_format_number(char* str, uint32_t number);
+bool _fen_has_piece(struct fen_position* position, int square, chessboard_color color, chessboard_piecetype type);
+bool _fen_has_piece_at(struct fen_position* position, int file, int row, chessboard_color color, chessboard_piecetype type);
+bool _fen_is_attacked(struct fen_position* position, int square, chessboard_color attacker);
+
+// Lowercase piece letters; callers fold the case first.
+chessboard_piecetype _fen_piecetype(char ch)
+{
+    for (int type = PAWN; type < CHESSBOARD_MAX_PIECETYPE; type++)
+    {
+	if (fen_piece_chars[type] == ch) return (chessboard_piecetype)type;
+    }
+    return EMPTY;
+}
+
+const char* _fen_parse_number(const char* str, uint32_t* number)
+{
+    if (*str < '0' || *str > '9') return NULL;
+    *number = 0;
+    for ( ; *str >= '0' && *str <= '9'; str++) *number = *number * 10 + (uint32_t)(*str - '0');
+    return str;
+}
+
+char* _fen_format_number(char* str, uint32_t number)
+{
+    char digits[10];
+    int count = 0;
+    do
+    {
+	digits[count++] = '0' + number % 10;
+	number /= 10;
+    } while (number);
+    while (count) *str++ = digits[--count];
+    return str;
+}
+
+bool _fen_has_piece(struct fen_position* position, int square, chessboard_color color, chessboard_piecetype type)
+{
+    return position->types[square] == type && position->colors[square] == color;
+}
+
+// Steps as (file, row), with row 0 being rank 8.  The king steps double
+// as the eight sliding directions; the diagonal ones are the bishop's.
+const int fen_knight_steps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+const int fen_king_steps[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+
+// Like _fen_has_piece, but false for squares off the board.
+bool _fen_has_piece_at(struct fen_position* position, int file, int row, chessboard_color color, chessboard_piecetype type)
+{
+    return file >= 0 && file < 8 && row >= 0 && row < 8 &&
+	_fen_has_piece(position, row * 8 + file, color, type);
+}
+
+/*
+A plain mailbox attack test.  It is only used to check positions as
+they are loaded, so it makes no attempt to be fast.
+ */
+bool _fen_is_attacked(struct fen_position* position, int square, chessboard_color attacker)
+{
+    int file = square % 8;
+    int row = square / 8;
+
+    // White pawns attack towards rank 8, so they stand one row below.
+    int pawn_row = row + ((attacker == WHITE) ? 1 : -1);
+    if (_fen_has_piece_at(position, file - 1, pawn_row, attacker, PAWN) ||
+	_fen_has_piece_at(position, file + 1, pawn_row, attacker, PAWN))
+    {
+	return true;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+	if (_fen_has_piece_at(position, file + fen_knight_steps[i][0], row + fen_knight_steps[i][1], attacker, KNIGHT) ||
+	    _fen_has_piece_at(position, file + fen_king_steps[i][0], row + fen_king_steps[i][1], attacker, KING))
+	{
+	    return true;
+	}
+
+	chessboard_piecetype slider = (fen_king_steps[i][0] && fen_king_steps[i][1]) ? BISHOP : ROOK;
+	int f = file + fen_king_steps[i][0];
+	int r = row + fen_king_steps[i][1];
+	while (f >= 0 && f < 8 && r >= 0 && r < 8 && position->types[r * 8 + f] == EMPTY)
+	{
+	    f += fen_king_steps[i][0];
+	    r += fen_king_steps[i][1];
+	}
+	if (_fen_has_piece_at(position, f, r, attacker, slider) ||
+	    _fen_has_piece_at(position, f, r, attacker, QUEEN))
+	{
+	    return true;
+	}
+    }
+    return false;
+}
+
+bool fen_is_consistent(struct fen_position* position)
+{
+    int kings[CHESSBOARD_MAX_COLOR] = {0, 0};
+    int king_square[CHESSBOARD_MAX_COLOR] = {0, 0};
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	chessboard_piecetype type = position->types[square];
+	if (type == PAWN && (square < A7 || square > H2)) return false;
+	if (type != KING) continue;
+	kings[position->colors[square]]++;
+	king_square[position->colors[square]] = square;
+    }
+    if (kings[WHITE] != 1 || kings[BLACK] != 1) return false;
+    // The player to move could take the other king.
+    if (_fen_is_attacked(position, king_square[!position->to_move], position->to_move)) return false;
+
+    uint32_t castle = position->castle;
+    if ((castle & (ZOBRIST_WHITE_SHORT | ZOBRIST_WHITE_LONG)) && !_fen_has_piece(position, E1, WHITE, KING)) return false;
+    if ((castle & ZOBRIST_WHITE_SHORT) && !_fen_has_piece(position, H1, WHITE, ROOK)) return false;
+    if ((castle & ZOBRIST_WHITE_LONG) && !_fen_has_piece(position, A1, WHITE, ROOK)) return false;
+    if ((castle & (ZOBRIST_BLACK_SHORT | ZOBRIST_BLACK_LONG)) && !_fen_has_piece(position, E8, BLACK, KING)) return false;
+    if ((castle & ZOBRIST_BLACK_SHORT) && !_fen_has_piece(position, H8, BLACK, ROOK)) return false;
+    if ((castle & ZOBRIST_BLACK_LONG) && !_fen_has_piece(position, A8, BLACK, ROOK)) return false;
+
+    int ep = (int)position->ep_square;
+    if (ep == CHESSBOARD_MAX_SQUARE) return true;
+    if (ep > CHESSBOARD_MAX_SQUARE) return false;
+    // The pawn is one row nearer the player to move than the square it
+    // passed, and came from one row further away.
+    int forward = (position->to_move == WHITE) ? 8 : -8;
+    if (ep / 8 != ((position->to_move == WHITE) ? 2 : 5)) return false;
+    return _fen_has_piece(position, ep + forward, !position->to_move, PAWN) &&
+	position->types[ep] == EMPTY && position->types[ep - forward] == EMPTY;
+}
+
+const char* fen_parse(const char* fen, struct fen_position* position)
+{
+    const char* p = fen;
+    int square = A8;
+    int file = 0;
+    int piece_counts[CHESSBOARD_MAX_COLOR] = {0, 0};
+
+    // Piece placement, from A8 to H1.
+    for ( ; *p && *p != ' '; p++)
+    {
+	if (*p == '/')
+	{
+	    if (file != 8 || square == CHESSBOARD_MAX_SQUARE) return NULL;
+	    file = 0;
+	}
+	else if (*p >= '1' && *p <= '8')
+	{
+	    int run = *p - '0';
+	    if (file + run > 8) return NULL;
+	    for (int i = 0; i < run; i++)
+	    {
+		position->types[square] = EMPTY;
+		position->colors[square++] = CHESSBOARD_MAX_COLOR;
+	    }
+	    file += run;
+	}
+	else
+	{
+	    chessboard_color color = (*p >= 'a') ? BLACK : WHITE;
+	    chessboard_piecetype type = _fen_piecetype(*p | 0x20);
+	    if (type == EMPTY || file == 8 || ++piece_counts[color] > 16) return NULL;
+	    position->types[square] = type;
+	    position->colors[square++] = color;
+	    file++;
+	}
+    }
+    if (square != CHESSBOARD_MAX_SQUARE || file != 8) return NULL;
+
+    // Player to move
+    if (*p++ != ' ') return NULL;
+    if (*p == 'w') position->to_move = WHITE;
+    else if (*p == 'b') position->to_move = BLACK;
+    else return NULL;
+    p++;
+
+    // Castling rights
+    if (*p++ != ' ') return NULL;
+    position->castle = 0;
+    if (*p == '-')
+    {
+	p++;
+    }
+    else
+    {
+	for ( ; *p && *p != ' '; p++)
+	{
+	    switch (*p)
+	    {
+	    case 'K': position->castle |= ZOBRIST_WHITE_SHORT; break;
+	    case 'Q': position->castle |= ZOBRIST_WHITE_LONG; break;
+	    case 'k': position->castle |= ZOBRIST_BLACK_SHORT; break;
+	    case 'q': position->castle |= ZOBRIST_BLACK_LONG; break;
+	    default: return NULL;
+	    }
+	}
+    }
+
+    // En passant square
+    if (*p++ != ' ') return NULL;
+    if (*p == '-')
+    {
+	position->ep_square = CHESSBOARD_MAX_SQUARE;
+	p++;
+    }
+    else if (chessboard_is_file(p[0]) && (p[1] == '3' || p[1] == '6'))
+    {
+	position->ep_square = (uint32_t)('8' - p[1]) * 8 + (uint32_t)(p[0] - 'a');
+	p += 2;
+    }
+    else
+    {
+	return NULL;
+    }
+
+    // The move clocks are optional.
+    position->halfmove_clock = 0;
+    position->fullmove_number = 1;
+    if (p[0] == ' ' && p[1] >= '0' && p[1] <= '9')
+    {
+	p = _fen_parse_number(p + 1, &position->halfmove_clock);
+	if (*p++ != ' ') return NULL;
+	p = _fen_parse_number(p, &position->fullmove_number);
+	if (!p) return NULL;
+    }
+    if (*p && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') return NULL;
+    if (!fen_is_consistent(position)) return NULL;
+    return p;
+}
+
+void fen_format(struct fen_position* position, char* fen)
+{
+    char* p = fen;
+    for (int row = 0; row < 8; row++)
+    {
+	int empty = 0;
+	for (int file = 0; file < 8; file++)
+	{
+	    int square = row * 8 + file;
+	    chessboard_piecetype type = position->types[square];
+	    if (type == EMPTY)
+	    {
+		empty++;
+		continue;
+	    }
+	    if (empty) *p++ = '0' + empty;
+	    empty = 0;
+	    *p++ = (position->colors[square] == WHITE) ?
+		(fen_piece_chars[type] & ~0x20) : fen_piece_chars[type];
+	}
+	if (empty) *p++ = '0' + empty;
+	if (row < 7) *p++ = '/';
+    }
+
+    *p++ = ' ';
+    *p++ = (position->to_move == WHITE) ? 'w' : 'b';
+
+    *p++ = ' ';
+    if (!position->castle) *p++ = '-';
+    if (position->castle & ZOBRIST_WHITE_SHORT) *p++ = 'K';
+    if (position->castle & ZOBRIST_WHITE_LONG) *p++ = 'Q';
+    if (position->castle & ZOBRIST_BLACK_SHORT) *p++ = 'k';
+    if (position->castle & ZOBRIST_BLACK_LONG) *p++ = 'q';
+
+    *p++ = ' ';
+    if (position->ep_square == CHESSBOARD_MAX_SQUARE)
+    {
+	*p++ = '-';
+    }
+    else
+    {
+	*p++ = 'a' + position->ep_square % 8;
+	*p++ = '8' - position->ep_square / 8;
+    }
+
+    *p++ = ' ';
+    p = _fen_format_number(p, position->halfmove_clock);
+    *p++ = ' ';
+    p = _fen_format_number(p, position->fullmove_number);
+    *p = '\0';
+}
@@ -0,0 +1,48 @@
+#ifndef FEN_H
+#define FEN_H
+
+#include "chessboard_api.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+Forsyth-Edwards Notation, shared by all of the board representations.
+fen_parse turns the text into a plain 64-square mailbox plus the rest of
+the game state, and fen_format does the reverse, so each representation
+only has to copy its own pieces in or out.  Neither allocates.
+
+Castling rights use the ZOBRIST_ bits (see zobrist.h).  ep_square is
+CHESSBOARD_MAX_SQUARE if there is no en passant square.
+ */
+struct fen_position {
+    chessboard_piecetype types[CHESSBOARD_MAX_SQUARE];
+    chessboard_color colors[CHESSBOARD_MAX_SQUARE];
+    chessboard_color to_move;
+    uint32_t castle;
+    uint32_t ep_square;
+    uint32_t halfmove_clock;
+    uint32_t fullmove_number;
+};
+
+/*
+fen_parse returns a pointer just past the text it used, or a null
+pointer if the FEN is malformed or fen_is_consistent rejects it.  The
+move clocks may be left off (as they are in EPD), in which case they
+default to 0 and 1.
+ */
+const char* fen_parse(const char* fen, struct fen_position* position);
+
+/*
+fen_is_consistent checks the things the move generators take for
+granted, so that no representation has to check them itself: each side
+has exactly one king, the player not to move isn't in check, no pawn
+is on rank 1 or 8, every castling right has its king and rook on their
+home squares, and an en passant square is behind a pawn of the player
+not to move that could just have double-pushed (on rank 6 with white to
+move, rank 3 with black to move, with the square it passed and the
+square it came from both empty).
+ */
+bool fen_is_consistent(struct fen_position* position);
+void fen_format(struct fen_position* position, char* fen);
+
+#endif
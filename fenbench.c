@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chessboard_api.h"
+
+/*
+FEN benchmark
+-----------------------------------------------------------------------
+Checks that a handful of positions survive a trip through
+chessboard_set_fen and chessboard_get_fen unchanged, and through
+chessboard_pack and chessboard_unpack, then times loading and writing
+them both ways.  It also times setting up boards one at a time with
+chessboard_allocate and chessboard_free against taking them from an
+arena.  Usage:
+
+    fenbench.exe [iterations]
+
+Only the chessboard API is used here, so the same driver can be linked
+against any board representation.
+ */
+
+const char* test_fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/8/8/8/8/8/8/4K2k b - - 99 150",
+};
+#define NUM_TEST_FENS (int)(sizeof(test_fens) / sizeof(test_fens[0]))
+
+#define ARENA_BATCH 64
+
+double _elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char* argv[])
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    char fen[CHESSBOARD_MAX_FEN];
+    chessboard_packed packed[NUM_TEST_FENS];
+    struct timespec start;
+    int failures = 0;
+
+    chessboard* cb = chessboard_allocate();
+    if (!cb)
+    {
+	printf("DEBUG: Failed to allocate board\n");
+	return -2;
+    }
+
+    for (int i = 0; i < NUM_TEST_FENS; i++)
+    {
+	if (!chessboard_set_fen(cb, test_fens[i]))
+	{
+	    printf("Failed to load: %s\n", test_fens[i]);
+	    failures++;
+	    continue;
+	}
+	chessboard_get_fen(cb, fen);
+	if (strcmp(fen, test_fens[i]))
+	{
+	    printf("Round trip failed:\n  %s\n  %s\n", test_fens[i], fen);
+	    failures++;
+	}
+	chessboard_pack(cb, &packed[i]);
+	chessboard_initialize_board(cb);
+	if (!chessboard_unpack(cb, &packed[i]))
+	{
+	    printf("Failed to unpack: %s\n", test_fens[i]);
+	    failures++;
+	    continue;
+	}
+	chessboard_get_fen(cb, fen);
+	if (strcmp(fen, test_fens[i]))
+	{
+	    printf("Packing round trip failed:\n  %s\n  %s\n", test_fens[i], fen);
+	    failures++;
+	}
+    }
+    // The initial position should come back as the first test position.
+    chessboard_initialize_board(cb);
+    chessboard_get_fen(cb, fen);
+    if (strcmp(fen, test_fens[0]))
+    {
+	printf("Initial position is %s\n", fen);
+	failures++;
+    }
+    if (failures) return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++)
+    {
+	chessboard_set_fen(cb, test_fens[i % NUM_TEST_FENS]);
+    }
+    double seconds = _elapsed_seconds(&start);
+    printf("set_fen: %ld positions, %.3f s, %.0f per second\n", iterations, seconds,
+	   seconds > 0 ? (double)iterations / seconds : 0.0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++)
+    {
+	chessboard_get_fen(cb, fen);
+    }
+    seconds = _elapsed_seconds(&start);
+    printf("get_fen: %ld positions, %.3f s, %.0f per second\n", iterations, seconds,
+	   seconds > 0 ? (double)iterations / seconds : 0.0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++)
+    {
+	chessboard_unpack(cb, &packed[i % NUM_TEST_FENS]);
+    }
+    seconds = _elapsed_seconds(&start);
+    printf("unpack: %ld positions, %.3f s, %.0f per second\n", iterations, seconds,
+	   seconds > 0 ? (double)iterations / seconds : 0.0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++)
+    {
+	chessboard_pack(cb, &packed[i % NUM_TEST_FENS]);
+    }
+    seconds = _elapsed_seconds(&start);
+    printf("pack: %ld positions, %.3f s, %.0f per second\n", iterations, seconds,
+	   seconds > 0 ? (double)iterations / seconds : 0.0);
+
+    // A batch of boards per iteration, as a server might use per request.
+    chessboard* batch[ARENA_BATCH];
+    long boards = iterations / ARENA_BATCH * ARENA_BATCH;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < boards; i += ARENA_BATCH)
+    {
+	for (int j = 0; j < ARENA_BATCH; j++) batch[j] = chessboard_allocate();
+	for (int j = 0; j < ARENA_BATCH; j++) chessboard_free(batch[j]);
+    }
+    seconds = _elapsed_seconds(&start);
+    printf("allocate: %ld boards, %.3f s, %.0f per second\n", boards, seconds,
+	   seconds > 0 ? (double)boards / seconds : 0.0);
+
+    chessboard_arena* arena = chessboard_arena_allocate(ARENA_BATCH);
+    if (!arena) return -2;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < boards; i += ARENA_BATCH)
+    {
+	chessboard_allocate_many(arena, ARENA_BATCH, batch);
+	chessboard_arena_reset(arena);
+    }
+    seconds = _elapsed_seconds(&start);
+    printf("allocate_many: %ld boards, %.3f s, %.0f per second\n", boards, seconds,
+	   seconds > 0 ? (double)boards / seconds : 0.0);
+
+    chessboard_arena_free(arena);
+    chessboard_free(cb);
+    return 0;
+}
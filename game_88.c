@@ -0,0 +1,154 @@
+#include "game_88.h"
+#include "algmove_0x88.h"
+#include "movegen_0x88.h"
+#include "zobrist.h"
+#include "eval_0x88.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+c88_game* c88_game_allocate(uint32_t capacity)
+{
+    assert(capacity > 0 && capacity < C88_NO_POSITION);
+    c88_game* game = (c88_game *)malloc(sizeof(c88_game));
+    if (!game)
+    {
+	printf("DEBUG: Failed to allocate game\n");
+	return NULL;
+    }
+    game->pos_tree = (c88_position *)malloc(capacity * sizeof(c88_position));
+    game->freelist = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (!game->pos_tree || !game->freelist)
+    {
+	printf("DEBUG: Failed to allocate %u game positions\n", capacity);
+	free(game->pos_tree);
+	free(game->freelist);
+	free(game);
+	return NULL;
+    }
+    game->capacity = capacity;
+
+    zobrist_init();
+    cb88_eval_init();
+    chessboard_initialize_board(&game->pos_tree[C88_GAME_ROOT].board);
+    c88_game_reset(game, &game->pos_tree[C88_GAME_ROOT].board);
+    return game;
+}
+
+void c88_game_free(c88_game* game)
+{
+    assert(game && "Tried to free null pointer to game");
+    free(game->pos_tree);
+    free(game->freelist);
+    free(game);
+}
+
+void c88_game_reset(c88_game* game, chessboard* cb)
+{
+    c88_position* root = &game->pos_tree[C88_GAME_ROOT];
+    if (cb != &root->board) cb88_copy_board(&root->board, cb);
+    root->parent = C88_NO_POSITION;
+    root->first_child = C88_NO_POSITION;
+    root->next_sibling = C88_NO_POSITION;
+
+    // Stacked in reverse, so that nodes are handed out in pool order.
+    game->free_count = 0;
+    for (uint32_t i = game->capacity - 1; i > C88_GAME_ROOT; i--)
+    {
+	game->freelist[game->free_count++] = i;
+    }
+}
+
+uint32_t c88_game_play(c88_game* game, uint32_t parent, struct _move* move)
+{
+    c88_position* tree = game->pos_tree;
+    uint32_t* link = &tree[parent].first_child;
+    while (*link != C88_NO_POSITION)
+    {
+	struct _move* played = &tree[*link].move;
+	if (played->from == move->from && played->to == move->to &&
+	    played->promotion == move->promotion)
+	{
+	    return *link;
+	}
+	link = &tree[*link].next_sibling;
+    }
+    if (game->free_count == 0) return C88_NO_POSITION;
+
+    uint32_t pos = game->freelist[--game->free_count];
+    c88_position* node = &tree[pos];
+    struct undo_record undo;
+    cb88_copy_board(&node->board, &tree[parent].board);
+    cb88_make_move(&node->board, move, &undo);
+    node->move = *move;
+    node->parent = parent;
+    node->first_child = C88_NO_POSITION;
+    node->next_sibling = C88_NO_POSITION;
+    *link = pos;
+    return pos;
+}
+
+uint32_t c88_game_play_san(c88_game* game, uint32_t parent, const char* move_str, size_t len)
+{
+    struct move_list pseudo;
+    struct _move move;
+    chessboard* cb = &game->pos_tree[parent].board;
+
+    cb88_generate_pseudo_moves(cb, &pseudo);
+    if (!cb88_find_san_move(cb, move_str, len, &pseudo, &move)) return C88_NO_POSITION;
+    return c88_game_play(game, parent, &move);
+}
+
+// Takes pos out of its parent's list of children.
+void _c88_game_unlink(c88_game* game, uint32_t pos)
+{
+    c88_position* tree = game->pos_tree;
+    uint32_t* link = &tree[tree[pos].parent].first_child;
+    while (*link != pos) link = &tree[*link].next_sibling;
+    *link = tree[pos].next_sibling;
+    tree[pos].next_sibling = C88_NO_POSITION;
+}
+
+void c88_game_delete(c88_game* game, uint32_t pos)
+{
+    assert(pos != C88_GAME_ROOT && "Tried to delete the root of a game");
+    c88_position* tree = game->pos_tree;
+    _c88_game_unlink(game, pos);
+
+    // Walk down first children to a leaf, free it (which makes its next
+    // sibling the first child) and go back up, until pos itself is a
+    // leaf.  This needs no stack, however deep the tree is.
+    uint32_t node = pos;
+    while (true)
+    {
+	if (tree[node].first_child != C88_NO_POSITION)
+	{
+	    node = tree[node].first_child;
+	    continue;
+	}
+	game->freelist[game->free_count++] = node;
+	if (node == pos) break;
+	uint32_t parent = tree[node].parent;
+	tree[parent].first_child = tree[node].next_sibling;
+	node = parent;
+    }
+}
+
+void c88_game_promote(c88_game* game, uint32_t pos)
+{
+    c88_position* tree = game->pos_tree;
+    if (pos == C88_GAME_ROOT) return;
+    uint32_t parent = tree[pos].parent;
+    _c88_game_unlink(game, pos);
+    tree[pos].next_sibling = tree[parent].first_child;
+    tree[parent].first_child = pos;
+}
+
+uint32_t c88_game_main_line(c88_game* game, uint32_t pos)
+{
+    while (game->pos_tree[pos].first_child != C88_NO_POSITION)
+    {
+	pos = game->pos_tree[pos].first_child;
+    }
+    return pos;
+}
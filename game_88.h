@@ -1,15 +1,78 @@
 #ifndef GAME_88_H
 #define GAME_88_H
 
-#include "chess_api.h"
-#include "board_88.h"
-#include "move_88.h"
+#include "chessboard_api.h"
+#include "chessboard_0x88.h"
+#include "move_0x88.h"
+#include "position_88.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Game tree
+-----------------------------------------------------------------------
+A game with all of its variations, for the analysis GUI and the engine
+to share.  Every position in the tree is kept as a full board (see
+position_88.h), so jumping to any point of the game is a lookup rather
+than a replay from the start.
+
+All of the positions live in one pool allocated by c88_game_allocate.
+Free nodes are kept on a stack of indices in freelist, so adding and
+deleting moves never touches the heap.  Positions are always referred
+to by their index in pos_tree, and the root is C88_GAME_ROOT.
+
+c88_game_allocate returns a null pointer if allocation fails.  The game
+starts out as just the root, in the standard starting position.
+ */
+
+#define C88_GAME_ROOT 0
 
 typedef struct c88_game {
     c88_position* pos_tree;
     uint32_t* freelist;
-    c88_move* movelist;
+    uint32_t capacity;
+    // Number of indices on freelist
+    uint32_t free_count;
 } c88_game;
 
+c88_game* c88_game_allocate(uint32_t capacity);
+void c88_game_free(c88_game* game);
+
+/*
+c88_game_reset throws the whole tree away and starts again from a copy
+of cb.
+ */
+void c88_game_reset(c88_game* game, chessboard* cb);
+
+/*
+c88_game_play adds the position after "move" (which must be legal) as a
+child of "parent", and returns its index.  If the move was already
+played from there, the existing child is returned instead.  New moves
+go after the existing ones, so the main line stays first.  It returns
+C88_NO_POSITION if the pool is full.
+
+c88_game_play_san does the same for a move in standard algebraic
+notation, given as the "len" characters at move_str, and also returns
+C88_NO_POSITION if the move is illegal or unreadable.
+ */
+uint32_t c88_game_play(c88_game* game, uint32_t parent, struct _move* move);
+uint32_t c88_game_play_san(c88_game* game, uint32_t parent, const char* move_str, size_t len);
+
+/*
+c88_game_delete removes a position and everything after it from the
+tree, and returns their nodes to the pool.  The root can't be deleted.
+
+c88_game_promote makes the variation leading to a position the main
+line from its parent.
+ */
+void c88_game_delete(c88_game* game, uint32_t pos);
+void c88_game_promote(c88_game* game, uint32_t pos);
+
+/*
+c88_game_main_line follows the main line from pos to its end, and
+returns the index of the last position.
+ */
+uint32_t c88_game_main_line(c88_game* game, uint32_t pos);
+
 #endif
@@ -0,0 +1,169 @@
+#include "chessboard_bb.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) && !defined(BB_NO_PEXT)
+#include <immintrin.h>
+#define BB_HAVE_PEXT
+#endif
+
+/*
+Slider attacks with magic bitboards.  Only the squares in a slider's
+mask (the squares it could see on an empty board, not counting the
+edge of the board, which is attacked whether or not it is occupied)
+affect its attacks.  Multiplying the masked occupancy by a well chosen
+"magic" number gathers those bits into the top of the product, so the
+top bits can be used as an index into a table of precomputed attacks.
+
+The magic numbers below were found by trying sparse random numbers 
+until every occupancy of the mask mapped to an index holding the right
+attacks.  They are specific to our square numbering (A8 = bit 0), so
+the usual published magics (which put A1 at bit 0) won't work here.
+bb_init_magics checks every entry as it fills the tables, so a bad
+magic trips an assert instead of silently giving wrong attacks.
+
+Processors with BMI2 can do the gathering directly with pext, which
+needs no magic number at all.  We check for it once at startup and fill
+the tables with whichever indexing we are going to use.
+ */
+
+const uint64_t bishop_magic_numbers[CHESSBOARD_MAX_SQUARE] =
+{0x8008029802002200ULL, 0x4291040808802804ULL, 0x0008180040800300ULL, 0x00088a0202aa1050ULL,
+ 0x000410a800000000ULL, 0x0009100804040009ULL, 0x0801140121080011ULL, 0xa040808400824000ULL,
+ 0x000008a004040048ULL, 0x0600200440808114ULL, 0x2020410401204403ULL, 0x000404106200c001ULL,
+ 0x0100011040800026ULL, 0x00080088200a0820ULL, 0x0008004804642080ULL, 0x4000004402981800ULL,
+ 0x0710002220020088ULL, 0x2010808202020402ULL, 0x8010080844002820ULL, 0x800c000124028000ULL,
+ 0x0002000422010040ULL, 0x6438402200422000ULL, 0x0010a1004c0c2000ULL, 0x000a00e109010190ULL,
+ 0x08022010400414c0ULL, 0x8428022220240101ULL, 0x0008088004040010ULL, 0x0008080000220020ULL,
+ 0x0421010000104000ULL, 0x219102082500a000ULL, 0x0018008042120150ULL, 0x02108020a09c0402ULL,
+ 0x301c202000890208ULL, 0xa004022000080100ULL, 0x100c024100881200ULL, 0x8000080800460a00ULL,
+ 0x1004010804440040ULL, 0x420c920080041000ULL, 0x05018c0114440100ULL, 0x00040100308a0080ULL,
+ 0x0020821042801000ULL, 0x0202026120001c02ULL, 0x0002001044000800ULL, 0x20aa844200800801ULL,
+ 0x0000012011001200ULL, 0x0860209008808042ULL, 0x0008100080a80200ULL, 0x0808020050420201ULL,
+ 0x00051c0104c00000ULL, 0x0000840108820022ULL, 0x000a461842080004ULL, 0x2400400914880002ULL,
+ 0x00040040102481b4ULL, 0x2104a14202020060ULL, 0x0004081041020060ULL, 0x00a0840082005100ULL,
+ 0x0000412210101482ULL, 0x0108504208042210ULL, 0x000020044c040405ULL, 0x4140050206051401ULL,
+ 0x0122008051820200ULL, 0x0082800428109100ULL, 0x9104042454440401ULL, 0x141e200c00820848ULL};
+
+const uint64_t rook_magic_numbers[CHESSBOARD_MAX_SQUARE] =
+{0x0280038860400010ULL, 0x098020004000b080ULL, 0x2100110008402002ULL, 0x0880080081041000ULL,
+ 0x0200020020041008ULL, 0x2300040008010012ULL, 0x0c00283004008201ULL, 0x0180010000407a80ULL,
+ 0x0168800080400020ULL, 0x0010400040201000ULL, 0x1001002001001048ULL, 0x1001002408100100ULL,
+ 0x0801000408010012ULL, 0x4001000209000400ULL, 0x08a20004c8020001ULL, 0x2002801145002280ULL,
+ 0x0080860021004200ULL, 0x001000c009402002ULL, 0x00b0002004002800ULL, 0x100a808010020800ULL,
+ 0x8101010008000410ULL, 0x0244008002000480ULL, 0x0000040010810208ULL, 0x2000020000448534ULL,
+ 0x4104400480008033ULL, 0x0000810100204000ULL, 0x0440430900200010ULL, 0x4600240900100100ULL,
+ 0x0060080080040080ULL, 0x0001000300080400ULL, 0x0004084400011002ULL, 0x0023040200008041ULL,
+ 0x0580050043002080ULL, 0x0400804002802008ULL, 0x0001002001004010ULL, 0x1000200901001000ULL,
+ 0x4410800801800c00ULL, 0xa012003806001004ULL, 0x0020100104008802ULL, 0x0004808402000041ULL,
+ 0x0010400170898000ULL, 0x0080500020004004ULL, 0x1040408012020020ULL, 0x8010040008004040ULL,
+ 0x2001080100110004ULL, 0x0000020004008080ULL, 0x0021010810040002ULL, 0x0800008c43020024ULL,
+ 0x0000800021005100ULL, 0x0070201040008080ULL, 0x0000d04282006a00ULL, 0x0010014400080240ULL,
+ 0x0001080110050100ULL, 0x0012000810240600ULL, 0x0402000801040200ULL, 0x028100108a004100ULL,
+ 0x0050800300102045ULL, 0x8208210040120882ULL, 0x8010600101183441ULL, 0x020b000910006045ULL,
+ 0x0241001002480005ULL, 0x0081000400880241ULL, 0x0000009008024124ULL, 0x0048122980410402ULL};
+
+struct bb_magic bishop_magics[CHESSBOARD_MAX_SQUARE];
+struct bb_magic rook_magics[CHESSBOARD_MAX_SQUARE];
+uint64_t bishop_attack_table[BB_BISHOP_TABLE_SIZE];
+uint64_t rook_attack_table[BB_ROOK_TABLE_SIZE];
+
+bool use_pext = false;
+
+uint64_t _bb_pext(uint64_t occupied, uint64_t mask);
+uint32_t _bb_magic_index(struct bb_magic* magic, uint64_t occupied);
+uint64_t* _bb_init_slider(struct bb_magic* magics, const uint64_t* magic_numbers, uint64_t* table, bool is_bishop);
+
+#ifdef BB_HAVE_PEXT
+__attribute__((target("bmi2")))
+uint64_t _bb_pext(uint64_t occupied, uint64_t mask)
+{
+    return _pext_u64(occupied, mask);
+}
+#else
+uint64_t _bb_pext(uint64_t occupied, uint64_t mask)
+{
+    assert(false && "pext is not available");
+    return 0;
+}
+#endif
+
+uint32_t _bb_magic_index(struct bb_magic* magic, uint64_t occupied)
+{
+    if (use_pext) return (uint32_t)_bb_pext(occupied, magic->mask);
+    return (uint32_t)(((occupied & magic->mask) * magic->magic) >> magic->shift);
+}
+
+uint64_t bb_bishop_attacks(uint32_t square, uint64_t occupied)
+{
+    struct bb_magic* magic = &bishop_magics[square];
+    return magic->attacks[_bb_magic_index(magic, occupied)];
+}
+
+uint64_t bb_rook_attacks(uint32_t square, uint64_t occupied)
+{
+    struct bb_magic* magic = &rook_magics[square];
+    return magic->attacks[_bb_magic_index(magic, occupied)];
+}
+
+void bb_init_magics()
+{
+#ifdef BB_HAVE_PEXT
+    use_pext = __builtin_cpu_supports("bmi2");
+#endif
+    uint64_t* end = _bb_init_slider(bishop_magics, bishop_magic_numbers, bishop_attack_table, true);
+    assert(end == bishop_attack_table + BB_BISHOP_TABLE_SIZE);
+    end = _bb_init_slider(rook_magics, rook_magic_numbers, rook_attack_table, false);
+    assert(end == rook_attack_table + BB_ROOK_TABLE_SIZE);
+}
+
+/*
+Fills in the magics and attack table for one kind of slider and returns
+the end of the part of the table it used.  Each square gets a block of
+2^(bits in mask) entries, and we visit every subset of the mask with
+the usual carry-rippler trick.
+ */
+uint64_t* _bb_init_slider(struct bb_magic* magics, const uint64_t* magic_numbers, uint64_t* table, bool is_bishop)
+{
+    const uint64_t edges = BB_FILE_A | BB_FILE_H | BB_RANK_8 | BB_RANK_1;
+
+    for (int square = 0; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	struct bb_magic* magic = &magics[square];
+	uint64_t mask;
+	if (is_bishop)
+	{
+	    mask = bb_ray_bishop_attacks(square, 0) & ~edges;
+	}
+	else
+	{
+	    // A rook on an edge still needs the rest of that edge, so
+	    // the files and ranks are trimmed separately.
+	    uint64_t attacks = bb_ray_rook_attacks(square, 0);
+	    uint64_t file = BB_FILE_A << (square % 8);
+	    uint64_t rank = BB_RANK_8 << (square - square % 8);
+	    mask = (attacks & file & ~(BB_RANK_8 | BB_RANK_1)) |
+		(attacks & rank & ~(BB_FILE_A | BB_FILE_H));
+	}
+
+	magic->mask = mask;
+	magic->magic = magic_numbers[square];
+	magic->shift = 64 - __builtin_popcountll(mask);
+	magic->attacks = table;
+
+	uint64_t subset = 0;
+	do
+	{
+	    uint64_t attacks = is_bishop ?
+		bb_ray_bishop_attacks(square, subset) : bb_ray_rook_attacks(square, subset);
+	    uint64_t* entry = &magic->attacks[_bb_magic_index(magic, subset)];
+	    assert((*entry == 0 || *entry == attacks) && "Bad magic number");
+	    *entry = attacks;
+	    subset = (subset - mask) & mask;
+	} while (subset);
+
+	table += 1ULL << (64 - magic->shift);
+    }
+    return table;
+}
@@ -4,21 +4,73 @@
 
 #include <stdio.h> //For debugging
 
+/*
+On a 0x88 board, the difference between two legal squares determines
+which pieces could attack one from the other, and in which direction a
+slider would have to travel.  Adding CB88_ATTACK_OFFSET to (to - from)
+gives an index into the tables below, which are laid out so that each
+row is one rank difference (from -7 to 7) and each column one file
+difference (from -7 to 7, with a dead column at the end).  
+
+attack_table holds a mask of CB88_ATTACK_ bits for the pieces that
+attack along that difference, and step_table holds the step a slider
+takes on the way (or 0 if no slider can get there).  With these, most
+attackers can be ruled out with a single lookup.
+ */
+const uint8_t attack_table[CB88_ATTACK_TABLE_SIZE] =
+{0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+ 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00,
+ 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x20, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x04, 0x20, 0x04, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x19, 0x28, 0x19, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+ 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x28, 0x00, 0x28, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00,
+ 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x1a, 0x28, 0x1a, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x04, 0x20, 0x04, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x20, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00,
+ 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+ 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00,
+ 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00};
+
+const int8_t step_table[CB88_ATTACK_TABLE_SIZE] =
+{-17,   0,   0,   0,   0,   0,   0, -16,   0,   0,   0,   0,   0,   0, -15,   0,
+   0, -17,   0,   0,   0,   0,   0, -16,   0,   0,   0,   0,   0, -15,   0,   0,
+   0,   0, -17,   0,   0,   0,   0, -16,   0,   0,   0,   0, -15,   0,   0,   0,
+   0,   0,   0, -17,   0,   0,   0, -16,   0,   0,   0, -15,   0,   0,   0,   0,
+   0,   0,   0,   0, -17,   0,   0, -16,   0,   0, -15,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0, -17,   0, -16,   0, -15,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0, -17, -16, -15,   0,   0,   0,   0,   0,   0,   0,
+  -1,  -1,  -1,  -1,  -1,  -1,  -1,   0,   1,   1,   1,   1,   1,   1,   1,   0,
+   0,   0,   0,   0,   0,   0,  15,  16,  17,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,  15,   0,  16,   0,  17,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,  15,   0,   0,  16,   0,   0,  17,   0,   0,   0,   0,   0,
+   0,   0,   0,  15,   0,   0,   0,  16,   0,   0,   0,  17,   0,   0,   0,   0,
+   0,   0,  15,   0,   0,   0,   0,  16,   0,   0,   0,   0,  17,   0,   0,   0,
+   0,  15,   0,   0,   0,   0,   0,  16,   0,   0,   0,   0,   0,  17,   0,   0,
+  15,   0,   0,   0,   0,   0,   0,  16,   0,   0,   0,   0,   0,   0,  17,   0};
+
+// The attack_table bits for each piece type, by color.
+const uint8_t piece_attack_masks[2][CHESSBOARD_MAX_PIECETYPE] =
+{{0, CB88_ATTACK_WHITE_PAWN, CB88_ATTACK_KNIGHT, CB88_ATTACK_KING,
+  CB88_ATTACK_BISHOP, CB88_ATTACK_BISHOP | CB88_ATTACK_ROOK, CB88_ATTACK_ROOK},
+ {0, CB88_ATTACK_BLACK_PAWN, CB88_ATTACK_KNIGHT, CB88_ATTACK_KING,
+  CB88_ATTACK_BISHOP, CB88_ATTACK_BISHOP | CB88_ATTACK_ROOK, CB88_ATTACK_ROOK}};
+
 bool chessboard_move(chessboard* cb, chessboard_square from, chessboard_square to)
 {
     struct _move move =
 	(struct _move){.from=cb88_get_square(from),
 		       .to=cb88_get_square(to)};
+    struct undo_record undo;
     bool valid = cb88_is_move_valid(cb, &move);
-    if (valid) cb88_move_unchecked(cb, &move);
-
-    // Handle castling (TODO: Clean this up)
-    if (move.is_castle) _move_rook_castling(cb, &move);
-    if (move.is_king) cb->castle = (struct castle_rights){false};
-    if (move.is_white_kings_rook) cb->castle.white_short = false;
-    if (move.is_white_queens_rook) cb->castle.white_long = false;
-    if (move.is_black_kings_rook) cb->castle.black_short = false;
-    if (move.is_black_queens_rook) cb->castle.black_long = false;
+    if (valid)
+    {
+	cb88_make_move(cb, &move, &undo);
+	// The API leaves switching the current player to the caller.
+	chessboard_switch_current_player(cb);
+    }
 
     DEBUG_validate_board(cb);
     return valid;
@@ -28,8 +80,127 @@ void cb88_move_unchecked(chessboard* cb, struct _move* move)
 {
     cb88_clear_square(cb, move->to);
     cb->board[move->to] = cb->board[move->from];
-    cb->board[move->to]->square = move->to;
-    cb->board[move->from] = NULL;
+    cb->board[move->from] = CB88_NO_PIECE;
+
+    struct piece* piece = CB88_PIECE_AT(cb, move->to);
+    piece->square = move->to;
+    if (piece->type == KING) cb->king_square[piece->color] = move->to;
+    cb->hash ^= cb88_piece_key(piece->color, piece->type, move->from) ^
+	cb88_piece_key(piece->color, piece->type, move->to);
+    cb->eval_mg += cb88_eval_mg[piece->color][piece->type][move->to] -
+	cb88_eval_mg[piece->color][piece->type][move->from];
+    cb->eval_eg += cb88_eval_eg[piece->color][piece->type][move->to] -
+	cb88_eval_eg[piece->color][piece->type][move->from];
+}
+
+/*
+cb88_make_move plays a move that is already known to be at least
+pseudo-legal, including all of the side effects that 
+cb88_move_unchecked leaves out: the rook half of a castle, en passant 
+captures, promotions, castling rights, the en passant square and the
+move counters.  Unlike chessboard_move, it also passes the move to the
+other player.  
+
+cb88_unmake_move takes back the last move made on cb, given the same
+move and the undo record that cb88_make_move filled in.  Moves have to
+be unmade in the reverse order they were made.  
+ */
+void cb88_make_move(chessboard* cb, struct _move* move, struct undo_record* undo)
+{
+    chessboard_color color = cb->to_move;
+    undo->castle = cb->castle;
+    undo->ep_square = cb->ep_square;
+    undo->halfmove_clock = cb->halfmove_clock;
+    undo->captured_slot = CB88_MAX_PIECES;
+    undo->captured_type = EMPTY;
+
+    // The pawn captured en passant is beside the moving pawn, so it has
+    // the rank of the from square and the file of the to square.
+    uint32_t captured_square = move->is_en_passant ?
+	((move->from & 0x70) | (move->to & 0x07)) : move->to;
+    struct piece* captured = CB88_PIECE_AT(cb, captured_square);
+    if (captured)
+    {
+	undo->captured_slot = cb->board[captured_square] & 0xF;
+	undo->captured_type = captured->type;
+	cb88_clear_square(cb, captured_square);
+    }
+
+    cb88_move_unchecked(cb, move);
+    struct piece* piece = CB88_PIECE_AT(cb, move->to);
+    if (move->promotion != EMPTY)
+    {
+	piece->type = move->promotion;
+	cb->hash ^= cb88_piece_key(color, PAWN, move->to) ^
+	    cb88_piece_key(color, move->promotion, move->to);
+	cb->eval_mg += cb88_eval_mg[color][move->promotion][move->to] -
+	    cb88_eval_mg[color][PAWN][move->to];
+	cb->eval_eg += cb88_eval_eg[color][move->promotion][move->to] -
+	    cb88_eval_eg[color][PAWN][move->to];
+	cb->phase += cb88_phase_weights[move->promotion];
+    }
+    if (move->is_castle) _move_rook_castling(cb, move);
+
+    cb->hash ^= cb88_state_key(cb);
+    _update_castle_rights(cb, move);
+
+    int32_t diff = move->to - move->from;
+    bool is_pawn = (piece->type == PAWN) || (move->promotion != EMPTY);
+    cb->ep_square = (is_pawn && (diff == 32 || diff == -32)) ?
+	move->from + diff / 2 : CB88_MAX_INDEX;
+    cb->hash ^= cb88_state_key(cb);
+    cb->halfmove_clock = (is_pawn || captured) ? 0 : cb->halfmove_clock + 1;
+    if (color == BLACK) cb->fullmove_number++;
+
+    chessboard_switch_current_player(cb);
+}
+
+void cb88_unmake_move(chessboard* cb, struct _move* move, struct undo_record* undo)
+{
+    chessboard_switch_current_player(cb);
+    chessboard_color color = cb->to_move;
+
+    if (move->is_castle)
+    {
+	struct _move rook_move = {};
+	_get_castling_rook_squares(move, &rook_move.to, &rook_move.from);
+	cb88_move_unchecked(cb, &rook_move);
+    }
+    struct _move back = (struct _move){.from=move->to, .to=move->from};
+    cb88_move_unchecked(cb, &back);
+    if (move->promotion != EMPTY)
+    {
+	CB88_PIECE_AT(cb, move->from)->type = PAWN;
+	cb->hash ^= cb88_piece_key(color, move->promotion, move->from) ^
+	    cb88_piece_key(color, PAWN, move->from);
+	cb->eval_mg += cb88_eval_mg[color][PAWN][move->from] -
+	    cb88_eval_mg[color][move->promotion][move->from];
+	cb->eval_eg += cb88_eval_eg[color][PAWN][move->from] -
+	    cb88_eval_eg[color][move->promotion][move->from];
+	cb->phase -= cb88_phase_weights[move->promotion];
+    }
+
+    if (undo->captured_slot != CB88_MAX_PIECES)
+    {
+	uint32_t captured_square = move->is_en_passant ?
+	    ((move->from & 0x70) | (move->to & 0x07)) : move->to;
+	struct piece* captured = &cb->piecelist[!color][undo->captured_slot];
+	*captured = (struct piece){.color=!color,
+				   .type=undo->captured_type,
+				   .square=captured_square};
+	cb->board[captured_square] = CB88_SLOT(!color, undo->captured_slot);
+	cb->hash ^= cb88_piece_key(!color, undo->captured_type, captured_square);
+	cb->eval_mg += cb88_eval_mg[!color][undo->captured_type][captured_square];
+	cb->eval_eg += cb88_eval_eg[!color][undo->captured_type][captured_square];
+	cb->phase += cb88_phase_weights[undo->captured_type];
+    }
+
+    cb->hash ^= cb88_state_key(cb);
+    cb->castle = undo->castle;
+    cb->ep_square = undo->ep_square;
+    cb->hash ^= cb88_state_key(cb);
+    cb->halfmove_clock = undo->halfmove_clock;
+    if (color == BLACK) cb->fullmove_number--;
 }
 
 bool cb88_is_move_valid(chessboard* cb, struct _move* move)
@@ -143,6 +314,7 @@ bool cb88_is_castle_move_valid(chessboard* cb, struct _move* move)
 	{
 	    valid = (cb->castle.white_short &&
 		     move->from == cb88_get_square(E1) &&
+		     _is_castling_rook(cb, move->from+3, WHITE) &&
 		     cb88_get_piecetype(cb, move->to) == EMPTY &&
 		     cb88_get_piecetype(cb, move->from+1) == EMPTY &&
 		     !cb88_is_square_attacked(cb, move->from, BLACK) &&
@@ -154,8 +326,10 @@ bool cb88_is_castle_move_valid(chessboard* cb, struct _move* move)
 	    assert(diff == -2 && "_is_castle_move_valid was passed a king move that wasn't 2 squares right or left");
 	    valid = (cb->castle.white_long &&
 		     move->from == cb88_get_square(E1) &&
+		     _is_castling_rook(cb, move->from-4, WHITE) &&
 		     cb88_get_piecetype(cb, move->to) == EMPTY &&
 		     cb88_get_piecetype(cb, move->from-1) == EMPTY &&
+		     cb88_get_piecetype(cb, move->from-3) == EMPTY &&
 		     !cb88_is_square_attacked(cb, move->from, BLACK) &&
 		     !cb88_is_square_attacked(cb, move->from-1, BLACK) &&
 		     !cb88_is_square_attacked(cb, move->to, BLACK));
@@ -166,6 +340,7 @@ bool cb88_is_castle_move_valid(chessboard* cb, struct _move* move)
 	{
 	    valid = (cb->castle.black_short &&
 		     move->from == cb88_get_square(E8) &&
+		     _is_castling_rook(cb, move->from+3, BLACK) &&
 		     cb88_get_piecetype(cb, move->to) == EMPTY &&
 		     cb88_get_piecetype(cb, move->from+1) == EMPTY &&
 		     !cb88_is_square_attacked(cb, move->from, WHITE) &&
@@ -175,10 +350,12 @@ bool cb88_is_castle_move_valid(chessboard* cb, struct _move* move)
 	else
 	{
 	    assert(diff == -2 && "_is_castle_move_valid was passed a king move that wasn't 2 squares right or left");
-	    valid = (cb->castle.white_long &&
+	    valid = (cb->castle.black_long &&
 		     move->from == cb88_get_square(E8) &&
+		     _is_castling_rook(cb, move->from-4, BLACK) &&
 		     cb88_get_piecetype(cb, move->to) == EMPTY &&
 		     cb88_get_piecetype(cb, move->from-1) == EMPTY &&
+		     cb88_get_piecetype(cb, move->from-3) == EMPTY &&
 		     !cb88_is_square_attacked(cb, move->from, WHITE) &&
 		     !cb88_is_square_attacked(cb, move->from-1, WHITE) &&
 		     !cb88_is_square_attacked(cb, move->to, WHITE));
@@ -267,26 +444,6 @@ bool cb88_is_rook_move_valid(chessboard* cb, struct _move* move)
 	if (test == move->to) valid = true;
     }
 
-    // NOTE: The is_color_side_rook flags are only used for updating
-    // castling rights, so it's ok to be sloppy when we set these to
-    // true.  For instance, if any rook is leaving H1 (whether it's
-    // white or black) we know that white can't castle short.
-    if (valid && move->from == cb88_get_square(H1))
-    {
-	move->is_white_kings_rook = true;
-    }
-    else if (valid && move->from == cb88_get_square(H8))
-    {
-	move->is_black_kings_rook = true;
-    }
-    else if (valid && move->from == cb88_get_square(A1))
-    {
-	move->is_white_queens_rook = true;
-    }
-    else if (valid && move->from == cb88_get_square(A8))
-    {
-	move->is_black_queens_rook = true;
-    }
     return valid;
 }
 
@@ -321,15 +478,8 @@ bool cb88_is_pawn_move_valid(chessboard* cb, struct _move* move)
 
 bool cb88_is_player_in_check(chessboard* cb, chessboard_color player)
 {
-    int i = 0;
-    struct piece piece = cb->piecelist[player][i];
-    while (piece.type != KING)
-    {
-	i++;
-	piece = cb->piecelist[player][i];
-	assert(piece.color == player && "No king in piecelist");
-    }
-    return cb88_is_square_attacked(cb, piece.square, !player);
+    assert(cb->king_square[player] != CB88_MAX_INDEX && "No king on board");
+    return cb88_is_square_attacked(cb, cb->king_square[player], !player);
 }
 
 /*
@@ -338,44 +488,271 @@ In that case, passing the color is unnecessary because we can find the
 color by looking at the piece (the king) on the given square.  However,
 we also need to check if some empty squares are under attack when 
 castling, and it is necessary to pass a color in those cases.  
+
+Note that this can't be built on cb88_is_move_valid, which only accepts
+moves by the player to move and doesn't count pawn captures onto empty
+squares.  Empty piecelist slots have no attack bits, so they are skipped
+before their (invalid) square is ever looked at.
  */
 bool cb88_is_square_attacked(chessboard* cb, uint32_t square, chessboard_color attacker)
 {
-    bool valid = false;
     for (int i = 0; i < CB88_MAX_PIECES; i++)
     {
-	struct piece piece = cb->piecelist[attacker][i];
-	struct _move move = (struct _move){.from=piece.square,
-					   .to=square};
-	if (cb88_is_move_valid(cb, &move))
+	struct piece* piece = &cb->piecelist[attacker][i];
+	uint8_t mask = piece_attack_masks[attacker][piece->type];
+	if (!mask) continue;
+
+	uint32_t index = square - piece->square + CB88_ATTACK_OFFSET;
+	if (!(attack_table[index] & mask)) continue;
+	if (!(mask & CB88_ATTACK_SLIDERS) ||
+	    _is_ray_clear(cb, piece->square, square, step_table[index]))
 	{
-	    valid = true;
-	    break;
+	    return true;
 	}
     }
 
-    return valid;
+    return false;
+}
+
+/*
+cb88_is_attacked_after does the same test for the position after the
+player to move plays "move", without playing it.  The board is read as
+if the moved piece (and the castling rook) had already left their
+squares for the new ones, and a captured piece is ignored.  This is how
+moves are checked for giving check, or for leaving the mover's own king
+attacked, without trying each one.
+ */
+bool cb88_is_attacked_after(chessboard* cb, struct _move* move, uint32_t square, chessboard_color attacker)
+{
+    struct _move_squares after = {.from=move->from,
+				  .to=move->to,
+				  .captured=move->is_en_passant ?
+				  ((move->from & 0x70) | (move->to & 0x07)) : move->to,
+				  .rook_from=CB88_MAX_INDEX,
+				  .rook_to=CB88_MAX_INDEX};
+    if (move->is_castle) _get_castling_rook_squares(move, &after.rook_from, &after.rook_to);
+    bool is_mover = (attacker == cb->to_move);
+
+    for (int i = 0; i < CB88_MAX_PIECES; i++)
+    {
+	struct piece* piece = &cb->piecelist[attacker][i];
+	chessboard_piecetype type = piece->type;
+	uint32_t from = piece->square;
+	if (type == EMPTY) continue;
+	if (is_mover)
+	{
+	    if (from == move->from)
+	    {
+		from = move->to;
+		if (move->promotion != EMPTY) type = move->promotion;
+	    }
+	    else if (from == after.rook_from)
+	    {
+		from = after.rook_to;
+	    }
+	}
+	else if (from == after.captured)
+	{
+	    continue;
+	}
+
+	uint8_t mask = piece_attack_masks[attacker][type];
+	uint32_t index = square - from + CB88_ATTACK_OFFSET;
+	if (!(attack_table[index] & mask)) continue;
+	if (!(mask & CB88_ATTACK_SLIDERS)) return true;
+	int32_t step = step_table[index];
+	uint32_t test = from + step;
+	while (test != square && !_is_occupied_after(cb, &after, test)) test += step;
+	if (test == square) return true;
+    }
+
+    return false;
+}
+
+bool _is_occupied_after(chessboard* cb, struct _move_squares* after, uint32_t square)
+{
+    if (square == after->to || square == after->rook_to) return true;
+    if (square == after->from || square == after->captured || square == after->rook_from) return false;
+    return cb->board[square] != CB88_NO_PIECE;
+}
+
+/*
+cb88_does_piece_attack checks if "piece" could capture something on
+"square", regardless of whose move it is or what is on the square.  
+ */
+bool cb88_does_piece_attack(chessboard* cb, struct piece* piece, uint32_t square)
+{
+    if (piece->type == EMPTY || piece->square == square) return false;
+
+    uint8_t mask = piece_attack_masks[piece->color][piece->type];
+    uint32_t index = square - piece->square + CB88_ATTACK_OFFSET;
+    if (!(attack_table[index] & mask)) return false;
+    return !(mask & CB88_ATTACK_SLIDERS) ||
+	_is_ray_clear(cb, piece->square, square, step_table[index]);
+}
+
+/*
+cb88_see is a static exchange evaluation: it plays out every capture on
+the move's to square, least valuable attacker first, and returns what
+the player to move gains (in cb88_see_values units), assuming each side
+may stop capturing whenever carrying on would lose more.  Nothing is
+moved on the board.  Instead, pieces that have taken part are marked in
+"removed", which also uncovers the sliders behind them (x-rays).
+Removed is a bit per piecelist slot, and there are exactly 32 slots.
+
+Pins and checks are ignored, as they usually are in SEE.  A king is
+worth so much that capturing with it only pays when nothing can take it
+back.
+ */
+const int cb88_see_values[CHESSBOARD_MAX_PIECETYPE] = {0, 100, 320, 20000, 330, 900, 500};
+
+int cb88_see(chessboard* cb, struct _move* move)
+{
+    int gain[CB88_MAX_PIECES * 2 + 1];
+    uint32_t target = move->to;
+    uint32_t captured_square = move->is_en_passant ?
+	((move->from & 0x70) | (move->to & 0x07)) : target;
+    uint8_t from_slot = cb->board[move->from];
+    uint8_t captured_slot = cb->board[captured_square];
+    chessboard_color side = CB88_SLOT_COLOR(from_slot);
+    uint32_t removed = 1u << from_slot;
+    int depth = 0;
+
+    gain[0] = 0;
+    if (captured_slot != CB88_NO_PIECE)
+    {
+	gain[0] = cb88_see_values[CB88_SLOT_PIECE(cb, captured_slot)->type];
+	removed |= 1u << captured_slot;
+    }
+    int attacker_value = cb88_see_values[CB88_SLOT_PIECE(cb, from_slot)->type];
+    if (move->promotion != EMPTY)
+    {
+	gain[0] += cb88_see_values[move->promotion] - cb88_see_values[PAWN];
+	attacker_value = cb88_see_values[move->promotion];
+    }
+
+    while (true)
+    {
+	depth++;
+	side = !side;
+	// What the side that just captured has, if the other side takes back.
+	gain[depth] = attacker_value - gain[depth - 1];
+	if (-gain[depth - 1] < 0 && gain[depth] < 0) break;
+
+	uint8_t slot = _find_least_attacker(cb, target, side, removed);
+	if (slot == CB88_NO_PIECE) break;
+	removed |= 1u << slot;
+	attacker_value = cb88_see_values[CB88_SLOT_PIECE(cb, slot)->type];
+    }
+    while (--depth)
+    {
+	int stand = -gain[depth - 1];
+	gain[depth - 1] = -(stand > gain[depth] ? stand : gain[depth]);
+    }
+    return gain[0];
+}
+
+// The slot of the cheapest piece of "attacker" that attacks square once
+// the pieces in "removed" are gone, or CB88_NO_PIECE if there isn't one.
+uint8_t _find_least_attacker(chessboard* cb, uint32_t square, chessboard_color attacker, uint32_t removed)
+{
+    uint8_t best = CB88_NO_PIECE;
+    int best_value = 0;
+    for (int i = 0; i < CB88_MAX_PIECES; i++)
+    {
+	uint8_t slot = CB88_SLOT(attacker, i);
+	struct piece* piece = &cb->piecelist[attacker][i];
+	uint8_t mask = piece_attack_masks[attacker][piece->type];
+	if (!mask || (removed & (1u << slot))) continue;
+	if (best != CB88_NO_PIECE && cb88_see_values[piece->type] >= best_value) continue;
+
+	uint32_t index = square - piece->square + CB88_ATTACK_OFFSET;
+	if (!(attack_table[index] & mask)) continue;
+	if (mask & CB88_ATTACK_SLIDERS)
+	{
+	    int32_t step = step_table[index];
+	    uint32_t test = piece->square + step;
+	    while (test != square &&
+		   (cb->board[test] == CB88_NO_PIECE || (removed & (1u << cb->board[test]))))
+	    {
+		test += step;
+	    }
+	    if (test != square) continue;
+	}
+	best = slot;
+	best_value = cb88_see_values[piece->type];
+    }
+    return best;
+}
+
+// Checks that every square strictly between from and to is empty.
+bool _is_ray_clear(chessboard* cb, uint32_t from, uint32_t to, int32_t step)
+{
+    for (uint32_t test = from + step; test != to; test += step)
+    {
+	if (cb->board[test] != CB88_NO_PIECE) return false;
+    }
+    return true;
+}
+
+// Castling rights are only kept in step with the rooks by the moves, so
+// the rook itself is checked too, rather than trusting the rights.
+bool _is_castling_rook(chessboard* cb, uint32_t square, chessboard_color color)
+{
+    return cb88_get_piecetype(cb, square) == ROOK && cb88_get_color(cb, square) == color;
 }
 
 void _move_rook_castling(chessboard* cb, struct _move* move)
 {
     struct _move rook_move = {};
+    _get_castling_rook_squares(move, &rook_move.from, &rook_move.to);
+    assert(cb88_get_piecetype(cb, rook_move.from) == ROOK && "Invalid castle move attempted");
+    cb88_move_unchecked(cb, &rook_move);
+}
+
+void _get_castling_rook_squares(struct _move* move, uint32_t* rook_from, uint32_t* rook_to)
+{
     if (move->to == cb88_get_square(G1) || move->to == cb88_get_square(G8))
     {
-	assert(cb88_get_piecetype(cb, move->to+1) == ROOK && "Invalid short castle move attempted");
-	rook_move = (struct _move){.from=move->to+1,
-				   .to=move->to-1};
-	cb88_move_unchecked(cb, &rook_move);
+	*rook_from = move->to+1;
+	*rook_to = move->to-1;
     }
     else if (move->to == cb88_get_square(C1) || move->to == cb88_get_square(C8))
     {
-	assert(cb88_get_piecetype(cb, move->to-2) == ROOK && "Invalid long castle move attempted");
-	rook_move = (struct _move){.from=move->to-2,
-				   .to=move->to+1};
-	cb88_move_unchecked(cb, &rook_move);
+	*rook_from = move->to-2;
+	*rook_to = move->to+1;
     }
     else
     {
 	assert(false && "Invalid castle move attempted");
     }
 }
+
+/*
+Any move from or to a corner square means that rook has either moved
+or been captured, so it can't be used to castle any more.  
+ */
+void _update_castle_rights(chessboard* cb, struct _move* move)
+{
+    if (move->is_king)
+    {
+	if (cb->to_move == WHITE)
+	{
+	    cb->castle.white_short = false;
+	    cb->castle.white_long = false;
+	}
+	else
+	{
+	    cb->castle.black_short = false;
+	    cb->castle.black_long = false;
+	}
+    }
+    if (move->from == cb88_get_square(H1) || move->to == cb88_get_square(H1))
+	cb->castle.white_short = false;
+    if (move->from == cb88_get_square(A1) || move->to == cb88_get_square(A1))
+	cb->castle.white_long = false;
+    if (move->from == cb88_get_square(H8) || move->to == cb88_get_square(H8))
+	cb->castle.black_short = false;
+    if (move->from == cb88_get_square(A8) || move->to == cb88_get_square(A8))
+	cb->castle.black_long = false;
+}
@@ -14,14 +14,58 @@ struct _move {
     uint32_t to;
 
     bool is_king;
-    bool is_white_kings_rook;
-    bool is_white_queens_rook;
-    bool is_black_kings_rook;
-    bool is_black_queens_rook;
     bool is_castle;
+    bool is_en_passant;
+    // EMPTY unless the move is a pawn promotion.
+    chessboard_piecetype promotion;
 };
 
+/*
+cb88_make_move fills an undo_record with everything cb88_unmake_move 
+can't work out from the move itself.  The captured piece is remembered
+by its slot in the piecelist, so unmaking a capture puts it back exactly
+where it was.  
+ */
+struct undo_record {
+    struct castle_rights castle;
+    uint8_t ep_square;
+    // CB88_MAX_PIECES if the move wasn't a capture
+    uint8_t captured_slot;
+    uint8_t captured_type;
+    uint32_t halfmove_clock;
+};
+
+/*
+Bits for the 0x88 attack table (see move_0x88.c).  Queens use both the
+bishop and rook bits.  
+ */
+#define CB88_ATTACK_TABLE_SIZE 240
+#define CB88_ATTACK_OFFSET 119
+#define CB88_ATTACK_WHITE_PAWN 0x01
+#define CB88_ATTACK_BLACK_PAWN 0x02
+#define CB88_ATTACK_KNIGHT 0x04
+#define CB88_ATTACK_KING 0x08
+#define CB88_ATTACK_BISHOP 0x10
+#define CB88_ATTACK_ROOK 0x20
+#define CB88_ATTACK_SLIDERS (CB88_ATTACK_BISHOP | CB88_ATTACK_ROOK)
+
+// The squares a move changes, for cb88_is_attacked_after
+struct _move_squares {
+    uint32_t from;
+    uint32_t to;
+    uint32_t captured;
+    uint32_t rook_from;
+    uint32_t rook_to;
+};
+
+extern const uint8_t attack_table[CB88_ATTACK_TABLE_SIZE];
+extern const int8_t step_table[CB88_ATTACK_TABLE_SIZE];
+extern const uint8_t piece_attack_masks[2][CHESSBOARD_MAX_PIECETYPE];
+extern const int cb88_see_values[CHESSBOARD_MAX_PIECETYPE];
+
 void cb88_move_unchecked(chessboard* cb, struct _move* move);
+void cb88_make_move(chessboard* cb, struct _move* move, struct undo_record* undo);
+void cb88_unmake_move(chessboard* cb, struct _move* move, struct undo_record* undo);
 bool cb88_is_move_valid(chessboard* cb, struct _move* move);
 bool cb88_is_knight_move_valid(chessboard* cb, struct _move* move);
 bool cb88_is_king_move_valid(chessboard* cb, struct _move* move);
@@ -33,7 +77,16 @@ bool cb88_is_pawn_move_valid(chessboard* cb, struct _move* move);
 
 bool cb88_is_player_in_check(chessboard* cb, chessboard_color player);
 bool cb88_is_square_attacked(chessboard* cb, uint32_t square, chessboard_color attacker);
+bool cb88_is_attacked_after(chessboard* cb, struct _move* move, uint32_t square, chessboard_color attacker);
+bool cb88_does_piece_attack(chessboard* cb, struct piece* piece, uint32_t square);
+int cb88_see(chessboard* cb, struct _move* move);
 
+bool _is_castling_rook(chessboard* cb, uint32_t square, chessboard_color color);
 void _move_rook_castling(chessboard* cb, struct _move* move);
+void _get_castling_rook_squares(struct _move* move, uint32_t* rook_from, uint32_t* rook_to);
+void _update_castle_rights(chessboard* cb, struct _move* move);
+bool _is_ray_clear(chessboard* cb, uint32_t from, uint32_t to, int32_t step);
+uint8_t _find_least_attacker(chessboard* cb, uint32_t square, chessboard_color attacker, uint32_t removed);
+bool _is_occupied_after(chessboard* cb, struct _move_squares* after, uint32_t square);
 
 #endif
@@ -0,0 +1,459 @@
+#include "movegen_0x88.h"
+#include "perft_table.h"
+#include <assert.h>
+#include <stdint.h>
+
+/*
+Move generation for the 0x88 board.  Rather than testing from/to pairs
+with cb88_is_move_valid, we walk the piecelist of the player to move and
+step each piece along its offsets, using the 0x88 test to notice when a
+step has fallen off the board.  
+
+cb88_generate_pseudo_moves produces every move that obeys the movement
+rules but may leave the mover's own king in check.  cb88_generate_moves
+filters those down to the legal moves, using the checks and pins found
+once per position by cb88_get_check_info rather than trying each move.
+
+Each generator takes the kinds of move (CB88_GEN_ bits) to produce, so
+cb88_generate_captures and cb88_generate_quiets can split the pseudo
+moves between them without generating either half twice.
+ */
+
+const int32_t knight_steps[8] = {33, 31, 18, 14, -33, -31, -18, -14};
+const int32_t king_steps[8] = {1, 17, 16, 15, -1, -17, -16, -15};
+const int32_t bishop_steps[4] = {17, 15, -17, -15};
+const int32_t rook_steps[4] = {16, 1, -16, -1};
+const int32_t queen_steps[8] = {17, 15, -17, -15, 16, 1, -16, -1};
+
+void _generate_piece_moves(chessboard* cb, struct move_list* list, struct piece* piece, uint32_t kinds)
+{
+    switch (piece->type)
+    {
+    case PAWN:
+	_generate_pawn_moves(cb, list, piece->square, kinds);
+	break;
+    case KNIGHT:
+	_generate_step_moves(cb, list, piece->square, knight_steps, 8, kinds);
+	break;
+    case KING:
+	_generate_step_moves(cb, list, piece->square, king_steps, 8, kinds);
+	if (kinds & CB88_GEN_QUIETS) _generate_castle_moves(cb, list, piece->square);
+	break;
+    case BISHOP:
+	_generate_slider_moves(cb, list, piece->square, bishop_steps, 4, kinds);
+	break;
+    case ROOK:
+	_generate_slider_moves(cb, list, piece->square, rook_steps, 4, kinds);
+	break;
+    case QUEEN:
+	_generate_slider_moves(cb, list, piece->square, queen_steps, 8, kinds);
+	break;
+    default:
+	break;
+    }
+}
+
+void _generate_kinds(chessboard* cb, struct move_list* list, uint32_t kinds)
+{
+    list->count = 0;
+    chessboard_color color = cb->to_move;
+    for (int i = 0; i < CB88_MAX_PIECES; i++)
+    {
+	_generate_piece_moves(cb, list, &cb->piecelist[color][i], kinds);
+    }
+    assert(list->count <= CB88_MAX_MOVES);
+}
+
+void cb88_generate_pseudo_moves(chessboard* cb, struct move_list* list)
+{
+    _generate_kinds(cb, list, CB88_GEN_ALL);
+}
+
+void cb88_generate_captures(chessboard* cb, struct move_list* list)
+{
+    _generate_kinds(cb, list, CB88_GEN_CAPTURES);
+}
+
+void cb88_generate_quiets(chessboard* cb, struct move_list* list)
+{
+    _generate_kinds(cb, list, CB88_GEN_QUIETS);
+}
+
+/*
+cb88_find_pseudo_move checks a move that came from somewhere other than
+the generator, like a transposition table or a killer slot, that may not
+even fit the position.  Only the from, to and promotion fields need to
+be filled in.  If the move is one the piece on "from" can make, the
+rest of the fields are filled in and it returns true.
+ */
+bool cb88_find_pseudo_move(chessboard* cb, struct _move* move)
+{
+    struct move_list list;
+    struct piece* piece = CB88_PIECE_AT(cb, move->from);
+    if (!piece || piece->color != cb->to_move) return false;
+
+    list.count = 0;
+    _generate_piece_moves(cb, &list, piece, CB88_GEN_ALL);
+    for (int i = 0; i < list.count; i++)
+    {
+	if (list.moves[i].to == move->to && list.moves[i].promotion == move->promotion)
+	{
+	    *move = list.moves[i];
+	    return true;
+	}
+    }
+    return false;
+}
+
+// Like cb88_generate_pseudo_moves, but only for pieces of one type.  A
+// move in algebraic notation names its piece, so this is all that
+// resolving one needs.
+void cb88_generate_piece_moves(chessboard* cb, chessboard_piecetype type, struct move_list* list)
+{
+    list->count = 0;
+    chessboard_color color = cb->to_move;
+    for (int i = 0; i < CB88_MAX_PIECES; i++)
+    {
+	struct piece* piece = &cb->piecelist[color][i];
+	if (piece->type == type) _generate_piece_moves(cb, list, piece, CB88_GEN_ALL);
+    }
+    assert(list->count <= CB88_MAX_MOVES);
+}
+
+void cb88_get_check_info(chessboard* cb, struct check_info* info)
+{
+    chessboard_color color = cb->to_move;
+    chessboard_color enemy = !color;
+    uint32_t king = cb->king_square[color];
+
+    *info = (struct check_info){.king=king};
+    if (king == CB88_MAX_INDEX)
+    {
+	info->targets = ~0ULL;
+	return;
+    }
+    for (int i = 0; i < CB88_MAX_PIECES; i++)
+    {
+	struct piece* piece = &cb->piecelist[enemy][i];
+	uint8_t mask = piece_attack_masks[enemy][piece->type];
+	if (!mask) continue;
+	uint32_t index = king - piece->square + CB88_ATTACK_OFFSET;
+	if (!(attack_table[index] & mask)) continue;
+	if (!(mask & CB88_ATTACK_SLIDERS))
+	{
+	    info->num_checkers++;
+	    info->targets |= CB88_BIT(piece->square);
+	    continue;
+	}
+
+	// A slider lined up with the king gives check if nothing is in
+	// the way, and pins a piece of ours if that is all that is.
+	int32_t step = step_table[index];
+	uint64_t line = CB88_BIT(piece->square);
+	uint32_t blocker = CB88_MAX_INDEX;
+	int num_blockers = 0;
+	for (uint32_t test = piece->square + step; test != king; test += step)
+	{
+	    if (cb->board[test] != CB88_NO_PIECE)
+	    {
+		blocker = test;
+		if (++num_blockers > 1 || CB88_SLOT_COLOR(cb->board[test]) != color) break;
+	    }
+	    line |= CB88_BIT(test);
+	}
+	if (num_blockers == 0)
+	{
+	    info->num_checkers++;
+	    info->targets |= line;
+	}
+	else if (num_blockers == 1 && CB88_SLOT_COLOR(cb->board[blocker]) == color)
+	{
+	    info->pinned |= CB88_BIT(blocker);
+	}
+    }
+    if (info->num_checkers == 0) info->targets = ~0ULL;
+    else if (info->num_checkers > 1) info->targets = 0;
+}
+
+/*
+King moves are legal if the king isn't attacked on its new square
+(castling was already checked by the generator).  Other moves have to
+deal with any check, and pinned pieces have to stay on the line through
+the king.  En passant can uncover the king along the rank by removing
+two pieces at once, so it is tested the slow way, with
+cb88_is_attacked_after.  None of this plays the move.
+ */
+bool cb88_is_pseudo_move_legal(chessboard* cb, struct check_info* info, struct _move* move)
+{
+    if (move->is_king)
+    {
+	return move->is_castle || !cb88_is_attacked_after(cb, move, move->to, !cb->to_move);
+    }
+    if (move->is_en_passant)
+    {
+	return info->king == CB88_MAX_INDEX ||
+	    !cb88_is_attacked_after(cb, move, info->king, !cb->to_move);
+    }
+    if (!(info->targets & CB88_BIT(move->to))) return false;
+    return !(info->pinned & CB88_BIT(move->from)) ||
+	step_table[move->to - info->king + CB88_ATTACK_OFFSET] ==
+	step_table[move->from - info->king + CB88_ATTACK_OFFSET];
+}
+
+/*
+cb88_is_move_legal is for a single move.  It plays the move, asks if the
+mover is in check, and takes it back again.  For many moves in the same
+position, cb88_get_check_info and cb88_is_pseudo_move_legal are faster.
+ */
+bool cb88_is_move_legal(chessboard* cb, struct _move* move)
+{
+    struct undo_record undo;
+    chessboard_color color = cb->to_move;
+
+    cb88_make_move(cb, move, &undo);
+    bool legal = !cb88_is_player_in_check(cb, color);
+    cb88_unmake_move(cb, move, &undo);
+    return legal;
+}
+
+void cb88_generate_moves(chessboard* cb, struct move_list* list)
+{
+    struct move_list pseudo;
+    struct check_info info;
+
+    cb88_get_check_info(cb, &info);
+    cb88_generate_pseudo_moves(cb, &pseudo);
+    list->count = 0;
+    for (int i = 0; i < pseudo.count; i++)
+    {
+	if (cb88_is_pseudo_move_legal(cb, &info, &pseudo.moves[i]))
+	{
+	    list->moves[list->count++] = pseudo.moves[i];
+	}
+    }
+}
+
+/*
+cb88_has_legal_move is for telling mate and stalemate apart from other
+positions.  It stops at the first legal move.
+ */
+bool cb88_has_legal_move(chessboard* cb)
+{
+    struct move_list pseudo;
+    struct check_info info;
+
+    cb88_get_check_info(cb, &info);
+    cb88_generate_pseudo_moves(cb, &pseudo);
+    for (int i = 0; i < pseudo.count; i++)
+    {
+	if (cb88_is_pseudo_move_legal(cb, &info, &pseudo.moves[i])) return true;
+    }
+    return false;
+}
+
+/*
+The last ply is never played out: the number of legal moves is already
+the number of leaves below this node.  
+ */
+uint64_t cb88_perft(chessboard* cb, int depth)
+{
+    struct move_list list;
+    struct undo_record undo;
+    uint64_t nodes = 0;
+
+    cb88_generate_moves(cb, &list);
+    if (depth <= 1) return (uint64_t)list.count;
+    for (int i = 0; i < list.count; i++)
+    {
+	cb88_make_move(cb, &list.moves[i], &undo);
+	nodes += cb88_perft(cb, depth - 1);
+	cb88_unmake_move(cb, &list.moves[i], &undo);
+    }
+    return nodes;
+}
+
+uint64_t chessboard_perft(chessboard* cb, int depth)
+{
+    return cb88_perft(cb, depth);
+}
+
+/*
+Only the last ply is too cheap to look up, since it is a single move
+generation.  Anything deeper costs a generation per reply, well over the
+price of a probe that misses the cache.
+ */
+uint64_t cb88_perft_hashed(chessboard* cb, int depth, struct perft_table* table)
+{
+    struct move_list list;
+    struct undo_record undo;
+    uint64_t nodes = 0;
+
+    if (depth > 1 && perft_table_probe(table, cb->hash, depth, &nodes)) return nodes;
+    cb88_generate_moves(cb, &list);
+    if (depth <= 1) return (uint64_t)list.count;
+    for (int i = 0; i < list.count; i++)
+    {
+	cb88_make_move(cb, &list.moves[i], &undo);
+	nodes += cb88_perft_hashed(cb, depth - 1, table);
+	cb88_unmake_move(cb, &list.moves[i], &undo);
+    }
+    if (depth > 1) perft_table_store(table, cb->hash, depth, nodes);
+    return nodes;
+}
+
+uint64_t chessboard_perft_hashed(chessboard* cb, int depth, chessboard_perft_table* table)
+{
+    return cb88_perft_hashed(cb, depth, table);
+}
+
+int chessboard_divide(chessboard* cb, int depth, chessboard_movespec* moves, uint64_t* counts)
+{
+    struct move_list list;
+    struct undo_record undo;
+
+    cb88_generate_moves(cb, &list);
+    for (int i = 0; i < list.count; i++)
+    {
+	struct _move* move = &list.moves[i];
+	moves[i] = (chessboard_movespec){.from=cb88_get_chessboard_square(move->from),
+					 .to=cb88_get_chessboard_square(move->to),
+					 .promotion=move->promotion};
+	counts[i] = 1;
+	if (depth > 1)
+	{
+	    cb88_make_move(cb, move, &undo);
+	    counts[i] = cb88_perft(cb, depth - 1);
+	    cb88_unmake_move(cb, move, &undo);
+	}
+    }
+    return list.count;
+}
+
+// Promotions count as captures, whether or not they take anything.
+void _generate_pawn_moves(chessboard* cb, struct move_list* list, uint32_t from, uint32_t kinds)
+{
+    chessboard_color color = cb->to_move;
+    // White pawns move towards rank 8, which is towards index 0.
+    int32_t forward = (color == WHITE) ? -16 : 16;
+    uint32_t start_rank = (color == WHITE) ? 6 : 1;
+    uint32_t last_rank = (color == WHITE) ? 0 : 7;
+    uint32_t targets[3] = {from + forward, from + forward - 1, from + forward + 1};
+
+    for (int i = 0; i < 3; i++)
+    {
+	uint32_t to = targets[i];
+	if (!cb88_is_square_legal(to)) continue;
+
+	bool is_en_passant = false;
+	bool is_promotion = (cb88_get_rank(to) == last_rank);
+	if (i == 0)
+	{
+	    // Advances need an empty square
+	    if (cb->board[to] != CB88_NO_PIECE) continue;
+	    if (!(kinds & (is_promotion ? CB88_GEN_CAPTURES : CB88_GEN_QUIETS))) continue;
+	    uint32_t double_to = to + forward;
+	    if (cb88_get_rank(from) == start_rank && cb->board[double_to] == CB88_NO_PIECE)
+	    {
+		list->moves[list->count++] = (struct _move){.from=from,
+							    .to=double_to};
+	    }
+	}
+	else if (!(kinds & CB88_GEN_CAPTURES))
+	{
+	    continue;
+	}
+	else if (to == cb->ep_square)
+	{
+	    is_en_passant = true;
+	}
+	else if (CB88_SLOT_COLOR(cb->board[to]) != (uint32_t)!color)
+	{
+	    // Captures need an enemy piece
+	    continue;
+	}
+
+	if (is_promotion)
+	{
+	    chessboard_piecetype promotions[4] = {QUEEN, ROOK, BISHOP, KNIGHT};
+	    for (int k = 0; k < 4; k++)
+	    {
+		list->moves[list->count++] = (struct _move){.from=from,
+							    .to=to,
+							    .promotion=promotions[k]};
+	    }
+	}
+	else
+	{
+	    list->moves[list->count++] = (struct _move){.from=from,
+							.to=to,
+							.is_en_passant=is_en_passant};
+	}
+    }
+}
+
+void _generate_step_moves(chessboard* cb, struct move_list* list, uint32_t from, const int32_t* steps, int num_steps, uint32_t kinds)
+{
+    chessboard_color color = cb->to_move;
+    bool is_king = (CB88_PIECE_AT(cb, from)->type == KING);
+    for (int i = 0; i < num_steps; i++)
+    {
+	uint32_t to = from + steps[i];
+	if (!cb88_is_square_legal(to)) continue;
+	uint32_t kind = (cb->board[to] == CB88_NO_PIECE) ? CB88_GEN_QUIETS :
+	    (CB88_SLOT_COLOR(cb->board[to]) != color) ? CB88_GEN_CAPTURES : 0;
+	if (kinds & kind)
+	{
+	    list->moves[list->count++] = (struct _move){.from=from,
+							.to=to,
+							.is_king=is_king};
+	}
+    }
+}
+
+void _generate_slider_moves(chessboard* cb, struct move_list* list, uint32_t from, const int32_t* steps, int num_steps, uint32_t kinds)
+{
+    chessboard_color color = cb->to_move;
+    for (int i = 0; i < num_steps; i++)
+    {
+	uint32_t to = from + steps[i];
+	while (cb88_is_square_legal(to))
+	{
+	    if (cb->board[to] != CB88_NO_PIECE)
+	    {
+		if ((kinds & CB88_GEN_CAPTURES) && CB88_SLOT_COLOR(cb->board[to]) != color)
+		{
+		    list->moves[list->count++] = (struct _move){.from=from,
+								.to=to};
+		}
+		break;
+	    }
+	    if (kinds & CB88_GEN_QUIETS)
+	    {
+		list->moves[list->count++] = (struct _move){.from=from,
+							    .to=to};
+	    }
+	    to += steps[i];
+	}
+    }
+}
+
+void _generate_castle_moves(chessboard* cb, struct move_list* list, uint32_t from)
+{
+    bool can_short = (cb->to_move == WHITE) ?
+	cb->castle.white_short : cb->castle.black_short;
+    bool can_long = (cb->to_move == WHITE) ?
+	cb->castle.white_long : cb->castle.black_long;
+
+    // cb88_is_castle_move_valid does the real work here.  The rights
+    // are checked first only to skip the attack tests when possible.
+    if (can_short)
+    {
+	struct _move move = (struct _move){.from=from, .to=from+2, .is_king=true};
+	if (cb88_is_castle_move_valid(cb, &move)) list->moves[list->count++] = move;
+    }
+    if (can_long)
+    {
+	struct _move move = (struct _move){.from=from, .to=from-2, .is_king=true};
+	if (cb88_is_castle_move_valid(cb, &move)) list->moves[list->count++] = move;
+    }
+}
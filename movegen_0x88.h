@@ -0,0 +1,75 @@
+#ifndef MOVEGEN_0X88_H
+#define MOVEGEN_0X88_H
+
+#include "chessboard_api.h"
+#include "chessboard_0x88.h"
+#include "move_0x88.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+No legal chess position has more than 218 legal moves, and even the
+pseudo-legal moves stay comfortably below 256, so a move_list can
+always live on the stack.
+ */
+#define CB88_MAX_MOVES 256
+
+struct move_list {
+    struct _move moves[CB88_MAX_MOVES];
+    int count;
+};
+
+/*
+Kinds of move, for generating only some of them.  Captures include en
+passant and every promotion, since those are the moves that change the
+material on the board.  Everything else, castling included, is quiet.
+ */
+#define CB88_GEN_CAPTURES 0x1
+#define CB88_GEN_QUIETS 0x2
+#define CB88_GEN_ALL (CB88_GEN_CAPTURES | CB88_GEN_QUIETS)
+
+void cb88_generate_pseudo_moves(chessboard* cb, struct move_list* list);
+void cb88_generate_captures(chessboard* cb, struct move_list* list);
+void cb88_generate_quiets(chessboard* cb, struct move_list* list);
+bool cb88_find_pseudo_move(chessboard* cb, struct _move* move);
+void cb88_generate_piece_moves(chessboard* cb, chessboard_piecetype type, struct move_list* list);
+void cb88_generate_moves(chessboard* cb, struct move_list* list);
+/*
+struct check_info describes how the king of the player to move is
+attacked, so that pseudo-legal moves can be told apart from legal ones
+without playing them.  cb88_get_check_info works it out once per
+position, from the enemy pieces that line up with the king, and
+cb88_is_pseudo_move_legal then tests each move against it.
+
+Square sets are bitboards over API squares (see CB88_BIT).
+ */
+#define CB88_BIT(square) (1ULL << (((square) + ((square) & 7)) >> 1))
+
+struct check_info {
+    uint32_t king;
+    int num_checkers;
+    // Squares that a move other than a king move has to end on: all of
+    // them if the king isn't in check, the checker and the squares
+    // between it and the king if there is one checker, and none in
+    // double check.
+    uint64_t targets;
+    // The mover's pieces that stand alone between the king and an enemy
+    // slider, and so can only move along that line.
+    uint64_t pinned;
+};
+
+void cb88_get_check_info(chessboard* cb, struct check_info* info);
+bool cb88_is_pseudo_move_legal(chessboard* cb, struct check_info* info, struct _move* move);
+bool cb88_is_move_legal(chessboard* cb, struct _move* move);
+bool cb88_has_legal_move(chessboard* cb);
+uint64_t cb88_perft(chessboard* cb, int depth);
+uint64_t cb88_perft_hashed(chessboard* cb, int depth, struct perft_table* table);
+
+void _generate_kinds(chessboard* cb, struct move_list* list, uint32_t kinds);
+void _generate_piece_moves(chessboard* cb, struct move_list* list, struct piece* piece, uint32_t kinds);
+void _generate_pawn_moves(chessboard* cb, struct move_list* list, uint32_t from, uint32_t kinds);
+void _generate_step_moves(chessboard* cb, struct move_list* list, uint32_t from, const int32_t* steps, int num_steps, uint32_t kinds);
+void _generate_slider_moves(chessboard* cb, struct move_list* list, uint32_t from, const int32_t* steps, int num_steps, uint32_t kinds);
+void _generate_castle_moves(chessboard* cb, struct move_list* list, uint32_t from);
+
+#endif
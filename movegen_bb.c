@@ -0,0 +1,267 @@
+#include "chessboard_bb.h"
+#include "perft_table.h"
+#include <assert.h>
+#include <stdint.h>
+
+/*
+Move generation for the bitboard board.  Pawns are generated a whole
+set at a time by shifting the pawn bitboard, and every other piece looks
+up its attack set and masks off its own pieces.  As in the 0x88 version,
+bb_generate_moves filters the pseudo-legal moves by making each one and
+checking that the mover's king is safe.
+ */
+
+void _bb_add_moves(struct bb_move_list* list, uint32_t from, uint64_t targets, chessboard_piecetype piece);
+void _bb_add_pawn_moves(struct bb_move_list* list, int32_t shift, uint64_t targets, uint8_t flags);
+void _bb_generate_castle_moves(chessboard* cb, struct bb_move_list* list);
+
+void _bb_add_moves(struct bb_move_list* list, uint32_t from, uint64_t targets, chessboard_piecetype piece)
+{
+    while (targets)
+    {
+	uint32_t to = bb_lsb(targets);
+	targets &= targets - 1;
+	list->moves[list->count++] = (struct bb_move){.from=from,
+						      .to=to,
+						      .piece=piece};
+    }
+}
+
+// Adds a pawn move to each square in targets, from the square "shift"
+// behind it.  Moves onto the first or last rank become four promotions.
+void _bb_add_pawn_moves(struct bb_move_list* list, int32_t shift, uint64_t targets, uint8_t flags)
+{
+    const chessboard_piecetype promotions[4] = {QUEEN, ROOK, BISHOP, KNIGHT};
+    while (targets)
+    {
+	uint32_t to = bb_lsb(targets);
+	targets &= targets - 1;
+	struct bb_move move = (struct bb_move){.from=to - shift,
+					       .to=to,
+					       .piece=PAWN,
+					       .flags=flags};
+	if (BB_BIT(to) & (BB_RANK_8 | BB_RANK_1))
+	{
+	    for (int k = 0; k < 4; k++)
+	    {
+		move.promotion = promotions[k];
+		list->moves[list->count++] = move;
+	    }
+	}
+	else
+	{
+	    list->moves[list->count++] = move;
+	}
+    }
+}
+
+void _bb_generate_castle_moves(chessboard* cb, struct bb_move_list* list)
+{
+    chessboard_color color = cb->to_move;
+    uint32_t short_right = (color == WHITE) ? BB_CASTLE_WHITE_SHORT : BB_CASTLE_BLACK_SHORT;
+    uint32_t long_right = (color == WHITE) ? BB_CASTLE_WHITE_LONG : BB_CASTLE_BLACK_LONG;
+    uint32_t king = (color == WHITE) ? E1 : E8;
+
+    if (!(cb->castle & (short_right | long_right))) return;
+    if (bb_is_square_attacked(cb, king, !color)) return;
+
+    if ((cb->castle & short_right) &&
+	!(cb->all & (BB_BIT(king + 1) | BB_BIT(king + 2))) &&
+	!bb_is_square_attacked(cb, king + 1, !color) &&
+	!bb_is_square_attacked(cb, king + 2, !color))
+    {
+	list->moves[list->count++] = (struct bb_move){.from=king,
+						      .to=king + 2,
+						      .piece=KING,
+						      .flags=BB_FLAG_CASTLE};
+    }
+    if ((cb->castle & long_right) &&
+	!(cb->all & (BB_BIT(king - 1) | BB_BIT(king - 2) | BB_BIT(king - 3))) &&
+	!bb_is_square_attacked(cb, king - 1, !color) &&
+	!bb_is_square_attacked(cb, king - 2, !color))
+    {
+	list->moves[list->count++] = (struct bb_move){.from=king,
+						      .to=king - 2,
+						      .piece=KING,
+						      .flags=BB_FLAG_CASTLE};
+    }
+}
+
+void bb_generate_pseudo_moves(chessboard* cb, struct bb_move_list* list)
+{
+    chessboard_color color = cb->to_move;
+    uint64_t* pieces = cb->pieces[color];
+    uint64_t empty = ~cb->all;
+    uint64_t enemy = cb->occupied[!color];
+    uint64_t targets = ~cb->occupied[color];
+    uint64_t bits;
+
+    list->count = 0;
+
+    // Pawns move and capture a whole bitboard at a time.
+    uint64_t pawns = pieces[PAWN];
+    uint64_t ep_bit = (cb->ep_square != CHESSBOARD_MAX_SQUARE) ? BB_BIT(cb->ep_square) : 0;
+    // Callers of the API may let the same player move twice, so make
+    // sure there really is an enemy pawn behind the en passant square.
+    uint64_t ep_pawn = (color == WHITE) ? (ep_bit << 8) : (ep_bit >> 8);
+    if (!(ep_pawn & cb->pieces[!color][PAWN])) ep_bit = 0;
+    if (color == WHITE)
+    {
+	uint64_t single = (pawns >> 8) & empty;
+	_bb_add_pawn_moves(list, -8, single, 0);
+	_bb_add_pawn_moves(list, -16, ((single & BB_RANK_3) >> 8) & empty, BB_FLAG_DOUBLE_PUSH);
+	_bb_add_pawn_moves(list, -9, (pawns >> 9) & ~BB_FILE_H & enemy, 0);
+	_bb_add_pawn_moves(list, -7, (pawns >> 7) & ~BB_FILE_A & enemy, 0);
+	_bb_add_pawn_moves(list, -9, (pawns >> 9) & ~BB_FILE_H & ep_bit, BB_FLAG_EN_PASSANT);
+	_bb_add_pawn_moves(list, -7, (pawns >> 7) & ~BB_FILE_A & ep_bit, BB_FLAG_EN_PASSANT);
+    }
+    else
+    {
+	uint64_t single = (pawns << 8) & empty;
+	_bb_add_pawn_moves(list, 8, single, 0);
+	_bb_add_pawn_moves(list, 16, ((single & BB_RANK_6) << 8) & empty, BB_FLAG_DOUBLE_PUSH);
+	_bb_add_pawn_moves(list, 9, (pawns << 9) & ~BB_FILE_A & enemy, 0);
+	_bb_add_pawn_moves(list, 7, (pawns << 7) & ~BB_FILE_H & enemy, 0);
+	_bb_add_pawn_moves(list, 9, (pawns << 9) & ~BB_FILE_A & ep_bit, BB_FLAG_EN_PASSANT);
+	_bb_add_pawn_moves(list, 7, (pawns << 7) & ~BB_FILE_H & ep_bit, BB_FLAG_EN_PASSANT);
+    }
+
+    for (bits = pieces[KNIGHT]; bits; bits &= bits - 1)
+    {
+	uint32_t from = bb_lsb(bits);
+	_bb_add_moves(list, from, knight_attacks[from] & targets, KNIGHT);
+    }
+    for (bits = pieces[BISHOP]; bits; bits &= bits - 1)
+    {
+	uint32_t from = bb_lsb(bits);
+	_bb_add_moves(list, from, bb_bishop_attacks(from, cb->all) & targets, BISHOP);
+    }
+    for (bits = pieces[ROOK]; bits; bits &= bits - 1)
+    {
+	uint32_t from = bb_lsb(bits);
+	_bb_add_moves(list, from, bb_rook_attacks(from, cb->all) & targets, ROOK);
+    }
+    for (bits = pieces[QUEEN]; bits; bits &= bits - 1)
+    {
+	uint32_t from = bb_lsb(bits);
+	uint64_t attacks = bb_bishop_attacks(from, cb->all) | bb_rook_attacks(from, cb->all);
+	_bb_add_moves(list, from, attacks & targets, QUEEN);
+    }
+    for (bits = pieces[KING]; bits; bits &= bits - 1)
+    {
+	uint32_t from = bb_lsb(bits);
+	_bb_add_moves(list, from, king_attacks[from] & targets, KING);
+    }
+    _bb_generate_castle_moves(cb, list);
+
+    assert(list->count <= BB_MAX_MOVES);
+}
+
+void bb_generate_moves(chessboard* cb, struct bb_move_list* list)
+{
+    struct bb_move_list pseudo;
+    struct bb_undo undo;
+    chessboard_color color = cb->to_move;
+
+    bb_generate_pseudo_moves(cb, &pseudo);
+    list->count = 0;
+    for (int i = 0; i < pseudo.count; i++)
+    {
+	bb_make_move(cb, &pseudo.moves[i], &undo);
+	if (!bb_is_player_in_check(cb, color))
+	{
+	    list->moves[list->count++] = pseudo.moves[i];
+	}
+	bb_unmake_move(cb, &pseudo.moves[i], &undo);
+    }
+}
+
+// Stops at the first legal move; see cb88_has_legal_move.
+bool bb_has_legal_move(chessboard* cb)
+{
+    struct bb_move_list pseudo;
+    chessboard_color color = cb->to_move;
+    uint32_t king = bb_lsb(cb->pieces[color][KING]);
+
+    bb_generate_pseudo_moves(cb, &pseudo);
+    for (int i = 0; i < pseudo.count; i++)
+    {
+	struct bb_move* move = &pseudo.moves[i];
+	if (!bb_is_attacked_after(cb, move, (move->piece == KING) ? move->to : king, !color)) return true;
+    }
+    return false;
+}
+
+uint64_t bb_perft(chessboard* cb, int depth)
+{
+    struct bb_move_list list;
+    struct bb_undo undo;
+    uint64_t nodes = 0;
+
+    bb_generate_moves(cb, &list);
+    if (depth <= 1) return (uint64_t)list.count;
+    for (int i = 0; i < list.count; i++)
+    {
+	bb_make_move(cb, &list.moves[i], &undo);
+	nodes += bb_perft(cb, depth - 1);
+	bb_unmake_move(cb, &list.moves[i], &undo);
+    }
+    return nodes;
+}
+
+uint64_t chessboard_perft(chessboard* cb, int depth)
+{
+    return bb_perft(cb, depth);
+}
+
+/*
+Only the last ply is too cheap to look up, since it is a single move
+generation.  Anything deeper costs a generation per reply, well over the
+price of a probe that misses the cache.
+ */
+uint64_t bb_perft_hashed(chessboard* cb, int depth, struct perft_table* table)
+{
+    struct bb_move_list list;
+    struct bb_undo undo;
+    uint64_t nodes = 0;
+
+    if (depth > 1 && perft_table_probe(table, cb->hash, depth, &nodes)) return nodes;
+    bb_generate_moves(cb, &list);
+    if (depth <= 1) return (uint64_t)list.count;
+    for (int i = 0; i < list.count; i++)
+    {
+	bb_make_move(cb, &list.moves[i], &undo);
+	nodes += bb_perft_hashed(cb, depth - 1, table);
+	bb_unmake_move(cb, &list.moves[i], &undo);
+    }
+    if (depth > 1) perft_table_store(table, cb->hash, depth, nodes);
+    return nodes;
+}
+
+uint64_t chessboard_perft_hashed(chessboard* cb, int depth, chessboard_perft_table* table)
+{
+    return bb_perft_hashed(cb, depth, table);
+}
+
+int chessboard_divide(chessboard* cb, int depth, chessboard_movespec* moves, uint64_t* counts)
+{
+    struct bb_move_list list;
+    struct bb_undo undo;
+
+    bb_generate_moves(cb, &list);
+    for (int i = 0; i < list.count; i++)
+    {
+	struct bb_move* move = &list.moves[i];
+	moves[i] = (chessboard_movespec){.from=move->from,
+					 .to=move->to,
+					 .promotion=move->promotion};
+	counts[i] = 1;
+	if (depth > 1)
+	{
+	    bb_make_move(cb, move, &undo);
+	    counts[i] = bb_perft(cb, depth - 1);
+	    bb_unmake_move(cb, move, &undo);
+	}
+    }
+    return list.count;
+}
@@ -0,0 +1,70 @@
+#include "pack.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACK_BLACK 0x8
+
+void pack_position(struct fen_position* position, chessboard_packed* packed)
+{
+    uint8_t* bytes = packed->bytes;
+    uint64_t occupied = 0;
+    int count = 0;
+
+    for (int i = 0; i < CHESSBOARD_PACKED_SIZE; i++) bytes[i] = 0;
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	chessboard_piecetype type = position->types[square];
+	if (type == EMPTY) continue;
+	occupied |= 1ULL << square;
+	uint8_t code = (uint8_t)type | ((position->colors[square] == BLACK) ? PACK_BLACK : 0);
+	bytes[8 + count / 2] |= (count & 1) ? (uint8_t)(code << 4) : code;
+	count++;
+    }
+    for (int i = 0; i < 8; i++) bytes[i] = (uint8_t)(occupied >> (8 * i));
+
+    bytes[24] = (uint8_t)(((position->to_move == BLACK) ? 1 : 0) | (position->castle << 1));
+    bytes[25] = (uint8_t)position->ep_square;
+    bytes[26] = (uint8_t)((position->halfmove_clock > 255) ? 255 : position->halfmove_clock);
+    uint32_t fullmove = (position->fullmove_number > 65535) ? 65535 : position->fullmove_number;
+    bytes[27] = (uint8_t)fullmove;
+    bytes[28] = (uint8_t)(fullmove >> 8);
+}
+
+bool unpack_position(const chessboard_packed* packed, struct fen_position* position)
+{
+    const uint8_t* bytes = packed->bytes;
+    uint64_t occupied = 0;
+    int count = 0;
+    int piece_counts[CHESSBOARD_MAX_COLOR] = {0, 0};
+
+    for (int i = 0; i < 8; i++) occupied |= (uint64_t)bytes[i] << (8 * i);
+    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+    {
+	position->types[square] = EMPTY;
+	position->colors[square] = CHESSBOARD_MAX_COLOR;
+	if (!(occupied & (1ULL << square))) continue;
+	if (count == 32) return false;
+
+	uint8_t code = (bytes[8 + count / 2] >> ((count & 1) ? 4 : 0)) & 0xF;
+	chessboard_piecetype type = (chessboard_piecetype)(code & ~PACK_BLACK);
+	chessboard_color color = (code & PACK_BLACK) ? BLACK : WHITE;
+	if (type == EMPTY || type >= CHESSBOARD_MAX_PIECETYPE || ++piece_counts[color] > 16) return false;
+	position->types[square] = type;
+	position->colors[square] = color;
+	count++;
+    }
+    // Unused piece codes must be zero, so that each position has only
+    // one packing.
+    for (int i = count; i < 32; i++)
+    {
+	if ((bytes[8 + i / 2] >> ((i & 1) ? 4 : 0)) & 0xF) return false;
+    }
+    if ((bytes[24] & 0xE0) || bytes[29] || bytes[30] || bytes[31]) return false;
+
+    position->to_move = (bytes[24] & 1) ? BLACK : WHITE;
+    position->castle = (bytes[24] >> 1) & 0xF;
+    position->ep_square = bytes[25];
+    position->halfmove_clock = bytes[26];
+    position->fullmove_number = (uint32_t)bytes[27] | ((uint32_t)bytes[28] << 8);
+    return fen_is_consistent(position);
+}
@@ -0,0 +1,22 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include "chessboard_api.h"
+#include "fen.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+Packed positions (see chessboard_pack in chessboard_api.h for the
+layout), shared by all of the board representations.  Like FEN, they go
+through the fen_position mailbox, so each representation only has to
+copy its own pieces in or out.
+
+unpack_position returns false if the packing is malformed (bad piece
+codes, more than 16 pieces a side or nonzero spare bits), or if the
+position fails fen_is_consistent, just as a FEN would.
+ */
+void pack_position(struct fen_position* position, chessboard_packed* packed);
+bool unpack_position(const chessboard_packed* packed, struct fen_position* position);
+
+#endif
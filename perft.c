@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "chessboard_api.h"
+
+/*
+Perft driver
+-----------------------------------------------------------------------
+Counts the leaf nodes of the legal move tree to a given depth and 
+reports how long it took.  Usage:
+
+    perft.exe [-divide] [-fen "fen"] [-threads n] [-hash mb] depth [move ...]
+
+The position is the starting position (or the one given with -fen),
+followed by any moves given in standard algebraic notation.  With
+-divide, the count at the final depth is broken down by root move,
+which is the quickest way to narrow down a move generation bug against
+a known-good engine.  
+
+-hash counts with chessboard_perft_hashed and a table of the given size
+in megabytes, shared by every thread and kept from one depth to the
+next.  With -threads, the tree is cut two plies down, each reply to
+each root move becomes an item of work, and the worker threads
+repeatedly claim the next item until there are none left.  There are
+hundreds of items to a few dozen threads, so a thread that draws a big
+subtree doesn't hold up the others.  The items are packed positions, so
+a worker only needs its own board to count one.  Depths below
+PERFT_SPLIT_DEPTH are too small to be worth splitting.
+
+Only the chessboard API is used here, so the same driver can be linked
+against any board representation.
+ */
+
+#define PERFT_SPLIT_DEPTH 3
+
+struct perft_item {
+    chessboard_packed position;
+    // The root move this item is a reply to.
+    int root;
+    uint64_t count;
+};
+
+struct perft_work {
+    struct perft_item* items;
+    size_t num_items;
+    size_t next_item;
+    // Depth left below each item.
+    int depth;
+    chessboard_perft_table* table;
+};
+
+struct perft_worker {
+    pthread_t thread;
+    struct perft_work* work;
+    chessboard* cb;
+};
+
+struct perft_pool {
+    struct perft_worker* workers;
+    int num_threads;
+    chessboard_perft_table* table;
+};
+
+const char piece_chars[CHESSBOARD_MAX_PIECETYPE] = {' ', 'p', 'n', 'k', 'b', 'q', 'r'};
+
+double _elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Writes a move in coordinate notation, like e2e4 or e7e8q.
+void _movespec_to_str(chessboard_movespec move, char* str)
+{
+    str[0] = 'a' + move.from % 8;
+    str[1] = '8' - move.from / 8;
+    str[2] = 'a' + move.to % 8;
+    str[3] = '8' - move.to / 8;
+    str[4] = piece_chars[move.promotion];
+    str[5] = '\0';
+    if (move.promotion == EMPTY) str[4] = '\0';
+}
+
+void _print_rate(uint64_t nodes, double seconds)
+{
+    if (seconds > 0)
+    {
+	printf(", %.3f s, %.0f nps\n", seconds, (double)nodes / seconds);
+    }
+    else
+    {
+	printf(", %.3f s\n", seconds);
+    }
+}
+
+// The API takes moves as SAN, so a move found by chessboard_divide is
+// played by writing it out first.  Returns false (a move generation or
+// SAN bug) if the move doesn't survive the trip.
+bool _play_movespec(chessboard* cb, chessboard_movespec move)
+{
+    char san[CHESSBOARD_MAX_SAN];
+    if (!chessboard_move_to_san(cb, move, san) || !chessboard_algmove(cb, san)) return false;
+    chessboard_switch_current_player(cb);
+    return true;
+}
+
+void* _perft_thread_main(void* arg)
+{
+    struct perft_worker* worker = (struct perft_worker *)arg;
+    struct perft_work* work = worker->work;
+
+    while (true)
+    {
+	size_t i = __atomic_fetch_add(&work->next_item, 1, __ATOMIC_RELAXED);
+	if (i >= work->num_items) break;
+	struct perft_item* item = &work->items[i];
+	chessboard_unpack(worker->cb, &item->position);
+	if (work->table)
+	{
+	    item->count = chessboard_perft_hashed(worker->cb, work->depth, work->table);
+	}
+	else
+	{
+	    item->count = chessboard_perft(worker->cb, work->depth);
+	}
+    }
+    return NULL;
+}
+
+/*
+Does the same as chessboard_divide, but shares the work out over the
+pool's threads.  Returns -1 if the work items can't be allocated or
+set up.
+ */
+int _pool_divide(struct perft_pool* pool, chessboard* cb, int depth,
+		 chessboard_movespec* moves, uint64_t* counts)
+{
+    if (depth < PERFT_SPLIT_DEPTH) return chessboard_divide(cb, depth, moves, counts);
+
+    chessboard_movespec replies[CHESSBOARD_MAX_MOVES];
+    uint64_t reply_counts[CHESSBOARD_MAX_MOVES];
+    chessboard_packed root, after_move;
+    // Worker 0 runs on this thread, so its board is free until then.
+    chessboard* scratch = pool->workers[0].cb;
+
+    int num_moves = chessboard_divide(cb, 1, moves, counts);
+    struct perft_work work = {.depth = depth - 2, .table = pool->table};
+    work.items = (struct perft_item *)malloc((num_moves + 1) * CHESSBOARD_MAX_MOVES * sizeof(struct perft_item));
+    if (!work.items) return -1;
+
+    chessboard_pack(cb, &root);
+    for (int i = 0; i < num_moves; i++)
+    {
+	chessboard_unpack(scratch, &root);
+	if (!_play_movespec(scratch, moves[i]))
+	{
+	    free(work.items);
+	    return -1;
+	}
+	chessboard_pack(scratch, &after_move);
+	int num_replies = chessboard_divide(scratch, 1, replies, reply_counts);
+	for (int j = 0; j < num_replies; j++)
+	{
+	    struct perft_item* item = &work.items[work.num_items++];
+	    chessboard_unpack(scratch, &after_move);
+	    if (!_play_movespec(scratch, replies[j]))
+	    {
+		free(work.items);
+		return -1;
+	    }
+	    chessboard_pack(scratch, &item->position);
+	    item->root = i;
+	}
+	counts[i] = 0;
+    }
+
+    // If a thread fails to start, the ones that did (at least this one)
+    // still claim every item.
+    int num_started = 1;
+    for (int i = 0; i < pool->num_threads; i++) pool->workers[i].work = &work;
+    for (int i = 1; i < pool->num_threads; i++)
+    {
+	if (pthread_create(&pool->workers[i].thread, NULL, _perft_thread_main, &pool->workers[i]))
+	{
+	    printf("DEBUG: Failed to start perft thread %d\n", i);
+	    break;
+	}
+	num_started = i + 1;
+    }
+    _perft_thread_main(&pool->workers[0]);
+    for (int i = 1; i < num_started; i++) pthread_join(pool->workers[i].thread, NULL);
+
+    for (size_t i = 0; i < work.num_items; i++)
+    {
+	counts[work.items[i].root] += work.items[i].count;
+    }
+    free(work.items);
+    return num_moves;
+}
+
+// Counts the position with the pool if there is one, and with
+// chessboard_divide or chessboard_perft if not.
+int _divide(struct perft_pool* pool, chessboard* cb, int depth,
+	    chessboard_movespec* moves, uint64_t* counts)
+{
+    return pool ? _pool_divide(pool, cb, depth, moves, counts) : chessboard_divide(cb, depth, moves, counts);
+}
+
+// Returns false, like _pool_divide, if the work can't be set up.
+bool _perft(struct perft_pool* pool, chessboard* cb, int depth, uint64_t* nodes)
+{
+    chessboard_movespec moves[CHESSBOARD_MAX_MOVES];
+    uint64_t counts[CHESSBOARD_MAX_MOVES];
+
+    if (!pool)
+    {
+	*nodes = chessboard_perft(cb, depth);
+	return true;
+    }
+    int num_moves = _pool_divide(pool, cb, depth, moves, counts);
+    if (num_moves < 0) return false;
+    *nodes = 0;
+    for (int i = 0; i < num_moves; i++) *nodes += counts[i];
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bool divide = false;
+    const char* fen = NULL;
+    int num_threads = 1;
+    int hash_mb = 0;
+    int arg = 1;
+    for ( ; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+	if (!strcmp(argv[arg], "-divide")) divide = true;
+	else if (!strcmp(argv[arg], "-fen") && arg + 1 < argc) fen = argv[++arg];
+	else if (!strcmp(argv[arg], "-threads") && arg + 1 < argc) num_threads = atoi(argv[++arg]);
+	else if (!strcmp(argv[arg], "-hash") && arg + 1 < argc) hash_mb = atoi(argv[++arg]);
+	else break;
+    }
+    if (arg >= argc || atoi(argv[arg]) < 1 || num_threads < 1 || hash_mb < 0)
+    {
+	printf("Usage: %s [-divide] [-fen \"fen\"] [-threads n] [-hash mb] depth [move ...]\n", argv[0]);
+	return -1;
+    }
+    int depth = atoi(argv[arg++]);
+
+    chessboard* cb = chessboard_allocate();
+    if (!cb)
+    {
+	printf("DEBUG: Failed to allocate board\n");
+	return -2;
+    }
+    chessboard_initialize_board(cb);
+    if (fen && !chessboard_set_fen(cb, fen))
+    {
+	printf("Bad FEN: %s\n", fen);
+	chessboard_free(cb);
+	return -1;
+    }
+    for ( ; arg < argc; arg++)
+    {
+	if (!chessboard_algmove(cb, argv[arg]))
+	{
+	    printf("Illegal move: %s\n", argv[arg]);
+	    chessboard_free(cb);
+	    return -1;
+	}
+	chessboard_switch_current_player(cb);
+    }
+
+    // The workers' boards come from one arena, as in pgn_replay.
+    struct perft_pool pool = {.num_threads = num_threads};
+    chessboard** boards = NULL;
+    chessboard_arena* arena = NULL;
+    bool use_pool = num_threads > 1 || hash_mb > 0;
+    if (use_pool)
+    {
+	pool.workers = (struct perft_worker *)calloc(num_threads, sizeof(struct perft_worker));
+	boards = (chessboard **)calloc(num_threads, sizeof(chessboard *));
+	arena = chessboard_arena_allocate(num_threads);
+	if (!pool.workers || !boards || !arena || !chessboard_allocate_many(arena, num_threads, boards))
+	{
+	    printf("DEBUG: Failed to allocate workers\n");
+	    return -2;
+	}
+	for (int i = 0; i < num_threads; i++) pool.workers[i].cb = boards[i];
+	if (hash_mb > 0 && !(pool.table = chessboard_perft_table_allocate(hash_mb)))
+	{
+	    return -2;
+	}
+    }
+
+    struct timespec start;
+    if (divide)
+    {
+	chessboard_movespec moves[CHESSBOARD_MAX_MOVES];
+	uint64_t counts[CHESSBOARD_MAX_MOVES];
+	uint64_t total = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int num_moves = _divide(use_pool ? &pool : NULL, cb, depth, moves, counts);
+	if (num_moves < 0)
+	{
+	    printf("DEBUG: Failed to set up work\n");
+	    return -2;
+	}
+	double seconds = _elapsed_seconds(&start);
+	for (int i = 0; i < num_moves; i++)
+	{
+	    char move_str[6];
+	    _movespec_to_str(moves[i], move_str);
+	    printf("%s: %llu\n", move_str, (unsigned long long)counts[i]);
+	    total += counts[i];
+	}
+	printf("\nMoves: %d\nNodes: %llu", num_moves, (unsigned long long)total);
+	_print_rate(total, seconds);
+    }
+    else
+    {
+	for (int d = 1; d <= depth; d++)
+	{
+	    clock_gettime(CLOCK_MONOTONIC, &start);
+	    uint64_t nodes;
+	    if (!_perft(use_pool ? &pool : NULL, cb, d, &nodes))
+	    {
+		printf("DEBUG: Failed to set up work\n");
+		return -2;
+	    }
+	    double seconds = _elapsed_seconds(&start);
+	    printf("perft(%d) = %llu", d, (unsigned long long)nodes);
+	    _print_rate(nodes, seconds);
+	}
+    }
+
+    if (pool.table) chessboard_perft_table_free(pool.table);
+    if (arena) chessboard_arena_free(arena);
+    free(boards);
+    free(pool.workers);
+    chessboard_free(cb);
+    return 0;
+}
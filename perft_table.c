@@ -0,0 +1,112 @@
+#include "perft_table.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Odd multiplier (from the golden ratio) that spreads depths over keys.
+#define PERFT_DEPTH_KEY 0x9E3779B97F4A7C15ULL
+
+uint64_t _perft_table_key(uint64_t hash, int depth);
+
+uint64_t _perft_table_key(uint64_t hash, int depth)
+{
+    return hash ^ ((uint64_t)depth * PERFT_DEPTH_KEY);
+}
+
+struct perft_table* perft_table_allocate(size_t megabytes)
+{
+    struct perft_table* table = (struct perft_table *)malloc(sizeof(struct perft_table));
+    if (!table)
+    {
+	printf("DEBUG: Failed to allocate perft table\n");
+	return NULL;
+    }
+
+    size_t buckets = 1;
+    while (buckets * 2 * sizeof(struct perft_bucket) <= megabytes * 1024 * 1024)
+    {
+	buckets *= 2;
+    }
+    table->buckets = (struct perft_bucket *)aligned_alloc(sizeof(struct perft_bucket),
+							   buckets * sizeof(struct perft_bucket));
+    if (!table->buckets)
+    {
+	printf("DEBUG: Failed to allocate %zu perft table buckets\n", buckets);
+	free(table);
+	return NULL;
+    }
+    table->bucket_mask = buckets - 1;
+    perft_table_clear(table);
+    return table;
+}
+
+void perft_table_free(struct perft_table* table)
+{
+    assert(table && "Tried to free null pointer to perft table");
+    free(table->buckets);
+    free(table);
+}
+
+void perft_table_clear(struct perft_table* table)
+{
+    memset(table->buckets, 0, (table->bucket_mask + 1) * sizeof(struct perft_bucket));
+}
+
+// An empty entry has data 0, which no store writes, since depth is at
+// least 1.
+bool perft_table_probe(struct perft_table* table, uint64_t hash, int depth, uint64_t* count)
+{
+    uint64_t key = _perft_table_key(hash, depth);
+    struct perft_entry* entries = table->buckets[key & table->bucket_mask].entries;
+    for (int i = 0; i < PERFT_BUCKET_ENTRIES; i++)
+    {
+	uint64_t check = __atomic_load_n(&entries[i].check, __ATOMIC_RELAXED);
+	uint64_t data = __atomic_load_n(&entries[i].data, __ATOMIC_RELAXED);
+	if (data && (check ^ data) == key && (int)(data & 0xFF) == depth)
+	{
+	    *count = data >> 8;
+	    return true;
+	}
+    }
+    return false;
+}
+
+void perft_table_store(struct perft_table* table, uint64_t hash, int depth, uint64_t count)
+{
+    uint64_t key = _perft_table_key(hash, depth);
+    struct perft_entry* entries = table->buckets[key & table->bucket_mask].entries;
+    struct perft_entry* replace = &entries[0];
+    int lowest_depth = 256;
+
+    for (int i = 0; i < PERFT_BUCKET_ENTRIES; i++)
+    {
+	uint64_t check = __atomic_load_n(&entries[i].check, __ATOMIC_RELAXED);
+	uint64_t data = __atomic_load_n(&entries[i].data, __ATOMIC_RELAXED);
+	if ((check ^ data) == key)
+	{
+	    replace = &entries[i];
+	    break;
+	}
+	int entry_depth = (int)(data & 0xFF);
+	if (entry_depth < lowest_depth)
+	{
+	    replace = &entries[i];
+	    lowest_depth = entry_depth;
+	}
+    }
+
+    uint64_t data = (count << 8) | (uint64_t)depth;
+    __atomic_store_n(&replace->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&replace->check, key ^ data, __ATOMIC_RELAXED);
+}
+
+chessboard_perft_table* chessboard_perft_table_allocate(size_t megabytes)
+{
+    return perft_table_allocate(megabytes);
+}
+
+void chessboard_perft_table_free(chessboard_perft_table* table)
+{
+    perft_table_free(table);
+}
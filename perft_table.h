@@ -0,0 +1,61 @@
+#ifndef PERFT_TABLE_H
+#define PERFT_TABLE_H
+
+#include "chessboard_api.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Perft table
+-----------------------------------------------------------------------
+A fixed-size hash table of perft counts, for chessboard_perft_hashed.
+A position reached again by a different move order has the same
+subtree below it, so its count only needs working out once.  Like the
+transposition table (see ttable.h) it is keyed by the Zobrist hash from
+chessboard_get_hash, so every representation can use it, and any number
+of threads can share one.
+
+The layout is the same as the transposition table's: 64-byte buckets
+of four 16-byte entries, picked by the low bits of the key.  The key
+mixes in the depth, so the counts for a position at different depths
+are separate entries.  An entry is the packed data (the count shifted
+up 8 bits, over the depth) and the key XORed with the data.  Threads
+read and write entries without locking, and an entry torn by two
+writers no longer matches its key, so it is just a miss.
+
+Counts have 56 bits, which is far more than any perft that finishes.
+Entries are replaced shallowest first, since deep subtrees are the ones
+that cost the most to count again.
+ */
+
+#define PERFT_BUCKET_ENTRIES 4
+
+struct perft_entry {
+    uint64_t check;
+    uint64_t data;
+};
+
+struct perft_bucket {
+    struct perft_entry entries[PERFT_BUCKET_ENTRIES];
+} __attribute__((aligned(64)));
+
+struct perft_table {
+    struct perft_bucket* buckets;
+    uint64_t bucket_mask;
+};
+
+/*
+perft_table_allocate returns a cleared table of at most "megabytes" MB
+(rounded down to a power-of-two number of buckets, and at least one
+bucket), or a null pointer if allocation fails.  Free it with
+perft_table_free.
+ */
+struct perft_table* perft_table_allocate(size_t megabytes);
+void perft_table_free(struct perft_table* table);
+void perft_table_clear(struct perft_table* table);
+
+bool perft_table_probe(struct perft_table* table, uint64_t hash, int depth, uint64_t* count);
+void perft_table_store(struct perft_table* table, uint64_t hash, int depth, uint64_t count);
+
+#endif
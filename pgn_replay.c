@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chessboard_api.h"
+
+/*
+PGN replay
+-----------------------------------------------------------------------
+Checks every game in a PGN file by replaying its moves on a chessboard,
+and reports how many games were valid and how fast they went.  Usage:
+
+    pgn_replay.exe [-threads n] [-v] file.pgn
+
+The file is mapped into memory rather than read, and games are never
+copied out of it.  The file is cut into fixed-size blocks, and each
+worker thread repeatedly claims the next block and replays the games
+that start in it (finishing the last one even if it runs past the end
+of the block).  A game starts at a line beginning with "[Event ", as the
+PGN standard requires.  Games with a FEN tag start from that position.
+
+Comments, variations, NAGs and move numbers are skipped.  A game is
+rejected at its first illegal or unreadable move; -v prints where.
+
+Only the chessboard API is used here, so the same driver can be linked
+against any board representation.
+ */
+
+#define REPLAY_BLOCK_SIZE (1 << 20)
+
+struct replay_file {
+    const char* data;
+    size_t size;
+    size_t next_block;
+    bool verbose;
+};
+
+struct replay_worker {
+    pthread_t thread;
+    struct replay_file* file;
+    chessboard* cb;
+    uint64_t games;
+    uint64_t rejected;
+    uint64_t moves;
+};
+
+double _elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Returns the offset of the first game starting at or after "from", or
+// the file size if there isn't one.  A game at the very start of the
+// file (or just after a UTF-8 byte order mark) has no newline before
+// it, so that case is checked first.
+size_t _find_game(struct replay_file* file, size_t from)
+{
+    if (from == 0)
+    {
+	size_t start = (file->size >= 3 && !memcmp(file->data, "\xEF\xBB\xBF", 3)) ? 3 : 0;
+	if (file->size - start >= 7 && !memcmp(file->data + start, "[Event ", 7)) return start;
+	from = 1;
+    }
+    const char* found = memmem(file->data + from - 1, file->size - from + 1, "\n[Event ", 8);
+    return found ? (size_t)(found - file->data) + 1 : file->size;
+}
+
+bool _is_space(char ch)
+{
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+// Sets up the board from the game's FEN tag, if it has one.
+bool _replay_tag(chessboard* cb, const char* tag, const char* end)
+{
+    char fen[CHESSBOARD_MAX_FEN];
+    if (end - tag < 7 || strncmp(tag, "[FEN \"", 6)) return true;
+    tag += 6;
+    const char* close = memchr(tag, '"', end - tag);
+    if (!close || close - tag >= CHESSBOARD_MAX_FEN) return false;
+    memcpy(fen, tag, close - tag);
+    fen[close - tag] = '\0';
+    return chessboard_set_fen(cb, fen);
+}
+
+/*
+Replays the game in [p, end) and returns true if every move was legal.
+Moves are parsed in place with chessboard_algmove_n.
+ */
+bool _replay_game(struct replay_worker* worker, const char* p, const char* end)
+{
+    chessboard* cb = worker->cb;
+
+    chessboard_initialize_board(cb);
+    while (p < end)
+    {
+	if (_is_space(*p))
+	{
+	    p++;
+	}
+	else if (*p == '[')
+	{
+	    const char* eol = memchr(p, '\n', end - p);
+	    if (!eol) eol = end;
+	    if (!_replay_tag(cb, p, eol)) return false;
+	    p = eol;
+	}
+	else if (*p == '{')
+	{
+	    const char* close = memchr(p, '}', end - p);
+	    p = close ? close + 1 : end;
+	}
+	else if (*p == ';' || *p == '%')
+	{
+	    const char* eol = memchr(p, '\n', end - p);
+	    p = eol ? eol : end;
+	}
+	else if (*p == '(')
+	{
+	    // Variations can nest, and can hold comments with parentheses.
+	    int depth = 0;
+	    for ( ; p < end; p++)
+	    {
+		if (*p == '{')
+		{
+		    const char* close = memchr(p, '}', end - p);
+		    p = close ? close : end - 1;
+		}
+		else if (*p == '(') depth++;
+		else if (*p == ')' && --depth == 0) break;
+	    }
+	    p++;
+	}
+	else if (*p == '$')
+	{
+	    for (p++; p < end && *p >= '0' && *p <= '9'; p++);
+	}
+	else if (*p == '*')
+	{
+	    return true;
+	}
+	else
+	{
+	    const char* start = p;
+	    while (p < end && !_is_space(*p) && *p != '{' && *p != '(' && *p != ';' && *p != '$') p++;
+	    // Move numbers like "12." or "12..." may run straight into the move.
+	    const char* move = start;
+	    while (move < p && *move >= '0' && *move <= '9') move++;
+	    if (move < p && *move == '.')
+	    {
+		while (move < p && *move == '.') move++;
+		p = move;
+		continue;
+	    }
+	    size_t length = p - start;
+	    if ((length == 3 && (!strncmp(start, "1-0", 3) || !strncmp(start, "0-1", 3))) ||
+		(length == 7 && !strncmp(start, "1/2-1/2", 7)))
+	    {
+		return true;
+	    }
+	    if (!chessboard_algmove_n(cb, start, length))
+	    {
+		if (worker->file->verbose)
+		{
+		    printf("Rejected move %.*s at offset %zu\n", (int)length, start,
+			   (size_t)(start - worker->file->data));
+		}
+		return false;
+	    }
+	    chessboard_switch_current_player(cb);
+	    worker->moves++;
+	}
+    }
+    return true;
+}
+
+void* _replay_thread_main(void* arg)
+{
+    struct replay_worker* worker = (struct replay_worker *)arg;
+    struct replay_file* file = worker->file;
+
+    while (true)
+    {
+	size_t block = __atomic_fetch_add(&file->next_block, 1, __ATOMIC_RELAXED);
+	size_t block_start = block * REPLAY_BLOCK_SIZE;
+	if (block_start >= file->size) break;
+	size_t block_end = block_start + REPLAY_BLOCK_SIZE;
+
+	size_t game = _find_game(file, block_start);
+	while (game < block_end && game < file->size)
+	{
+	    size_t next = _find_game(file, game + 1);
+	    worker->games++;
+	    if (!_replay_game(worker, file->data + game, file->data + next))
+	    {
+		worker->rejected++;
+	    }
+	    game = next;
+	}
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    struct replay_file file = {0};
+    int num_threads = 1;
+    int arg = 1;
+
+    for ( ; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+	if (!strcmp(argv[arg], "-threads") && arg + 1 < argc) num_threads = atoi(argv[++arg]);
+	else if (!strcmp(argv[arg], "-v")) file.verbose = true;
+	else break;
+    }
+    if (arg != argc - 1 || num_threads < 1)
+    {
+	printf("Usage: %s [-threads n] [-v] file.pgn\n", argv[0]);
+	return -1;
+    }
+
+    int fd = open(argv[arg], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+	printf("Can't open %s\n", argv[arg]);
+	return -1;
+    }
+    file.size = (size_t)st.st_size;
+    if (file.size == 0)
+    {
+	printf("Games: 0\n");
+	return 0;
+    }
+    file.data = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (file.data == MAP_FAILED)
+    {
+	printf("Can't map %s\n", argv[arg]);
+	return -1;
+    }
+    madvise((void *)file.data, file.size, MADV_SEQUENTIAL);
+
+    // Boards come from one arena, which keeps each worker's board on its
+    // own cache lines.
+    struct replay_worker* workers = (struct replay_worker *)calloc(num_threads, sizeof(struct replay_worker));
+    chessboard** boards = (chessboard **)calloc(num_threads, sizeof(chessboard *));
+    chessboard_arena* arena = chessboard_arena_allocate(num_threads);
+    if (!workers || !boards || !arena || !chessboard_allocate_many(arena, num_threads, boards))
+    {
+	printf("DEBUG: Failed to allocate workers\n");
+	return -2;
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+	workers[i].file = &file;
+	workers[i].cb = boards[i];
+    }
+
+    // If a thread fails to start, the ones that did (at least this one)
+    // still claim every block, and the rest count nothing.
+    struct timespec start;
+    int num_started = 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 1; i < num_threads; i++)
+    {
+	if (pthread_create(&workers[i].thread, NULL, _replay_thread_main, &workers[i]))
+	{
+	    printf("DEBUG: Failed to start replay thread %d\n", i);
+	    break;
+	}
+	num_started = i + 1;
+    }
+    _replay_thread_main(&workers[0]);
+
+    uint64_t games = 0, rejected = 0, moves = 0;
+    for (int i = 0; i < num_threads; i++)
+    {
+	if (i > 0 && i < num_started) pthread_join(workers[i].thread, NULL);
+	games += workers[i].games;
+	rejected += workers[i].rejected;
+	moves += workers[i].moves;
+    }
+    double seconds = _elapsed_seconds(&start);
+
+    printf("Games: %llu\nValidated: %llu\nRejected: %llu\nMoves: %llu\n",
+	   (unsigned long long)games, (unsigned long long)(games - rejected),
+	   (unsigned long long)rejected, (unsigned long long)moves);
+    printf("%.3f s", seconds);
+    if (seconds > 0)
+    {
+	printf(", %.0f games/s, %.0f moves/s, %.1f MB/s", (double)games / seconds,
+	       (double)moves / seconds, (double)file.size / seconds / (1024 * 1024));
+    }
+    printf("\n");
+
+    chessboard_arena_free(arena);
+    free(boards);
+    free(workers);
+    munmap((void *)file.data, file.size);
+    close(fd);
+    return 0;
+}
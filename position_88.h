@@ -1,17 +1,31 @@
 #ifndef POSITION_88_H
 #define POSITION_88_H
 
-#include "chess_api.h"
-#include "board_88.h"
+#include "chessboard_api.h"
+#include "chessboard_0x88.h"
+#include "move_0x88.h"
 #include <stdint.h>
 
+/*
+One node of a c88_game (see game_88.h): a whole 0x88 board, the move
+that led to it from its parent, and links to the rest of the tree.
+Nodes refer to each other by their index in the game's pool rather than
+by pointer, so the pool can be copied or saved as it is.
+
+A node's children are the moves played from it, kept as a list through
+first_child and next_sibling.  The first child is the main line and the
+others are variations, in the order they were added.
+ */
+
+#define C88_NO_POSITION UINT32_MAX
+
 typedef struct c88_position {
-    c88_board board;
-    chess_color to_move;
-    uint32_t ep_square;
-    uint8_t castle_rights;
-    uint8_t move_count;
-    uint8_t reversible_moves;    
+    chessboard board;
+    // Unused at the root.
+    struct _move move;
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t next_sibling;
 } c88_position;
 
 #endif
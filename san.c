@@ -0,0 +1,187 @@
+#include "san.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+const char san_piece_chars[CHESSBOARD_MAX_PIECETYPE] = {' ', 'P', 'N', 'K', 'B', 'Q', 'R'};
+
+chessboard_piecetype _san_piecetype(char ch);
+bool _san_parse_suffix(const char* str, size_t len, struct san_move* san);
+
+chessboard_piecetype _san_piecetype(char ch)
+{
+    switch (ch)
+    {
+    case 'K':
+	return KING;
+    case 'Q':
+	return QUEEN;
+    case 'R':
+	return ROOK;
+    case 'B':
+	return BISHOP;
+    case 'N':
+	return KNIGHT;
+    default:
+	return EMPTY;
+    }
+}
+
+// Check and mate signs and annotations like "!?" may follow a move.
+bool _san_parse_suffix(const char* str, size_t len, struct san_move* san)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+	if (str[i] == '+') san->check = SAN_CHECK;
+	else if (str[i] == '#') san->check = SAN_MATE;
+	else if (str[i] != '!' && str[i] != '?') return false;
+    }
+    return true;
+}
+
+/*
+After the piece letter, a move is a run of files, ranks and 'x's whose
+last two characters are the to square.  Any file or rank before those
+is a hint for the from square.  A promotion piece (with or without '=')
+and suffixes may follow.
+ */
+bool san_parse(const char* str, size_t len, struct san_move* san)
+{
+    size_t i = 0;
+    int files[2], ranks[2];
+    int num_files = 0, num_ranks = 0;
+    size_t file_pos = 0, rank_pos = 0;
+
+    *san = (struct san_move){.piece=PAWN,
+			     .to=CHESSBOARD_MAX_SQUARE,
+			     .from_file=-1,
+			     .from_rank=-1,
+			     .promotion=EMPTY,
+			     .castle=SAN_NO_CASTLE,
+			     .capture=false,
+			     .check=SAN_NO_CHECK};
+    if (len == 0) return false;
+
+    // Castling is "O-O" or "O-O-O", also spelled with o's or zeros.
+    char ch = str[0];
+    if (ch == 'O' || ch == 'o' || ch == '0')
+    {
+	int count = 1;
+	for (i = 1; i + 1 < len && str[i] == '-' && str[i + 1] == ch; i += 2) count++;
+	if (count != 2 && count != 3) return false;
+	san->piece = KING;
+	san->castle = (count == 2) ? SAN_CASTLE_SHORT : SAN_CASTLE_LONG;
+	return _san_parse_suffix(str + i, len - i, san);
+    }
+
+    if (_san_piecetype(ch) != EMPTY)
+    {
+	san->piece = _san_piecetype(ch);
+	i++;
+    }
+    for ( ; i < len; i++)
+    {
+	ch = str[i];
+	if (ch >= 'a' && ch <= 'h')
+	{
+	    if (num_files == 2) return false;
+	    files[num_files++] = ch - 'a';
+	    file_pos = i;
+	}
+	else if (ch >= '1' && ch <= '8')
+	{
+	    if (num_ranks == 2) return false;
+	    ranks[num_ranks++] = '8' - ch;
+	    rank_pos = i;
+	}
+	else if (ch == 'x')
+	{
+	    san->capture = true;
+	}
+	else
+	{
+	    break;
+	}
+    }
+    if (!num_files || !num_ranks || rank_pos != i - 1 || file_pos != i - 2) return false;
+    san->to = (chessboard_square)(ranks[num_ranks - 1] * 8 + files[num_files - 1]);
+    if (num_files == 2) san->from_file = files[0];
+    if (num_ranks == 2) san->from_rank = ranks[0];
+    if (san->piece == PAWN && san->from_file < 0) san->from_file = files[0];
+
+    if (san->piece == PAWN && i < len)
+    {
+	if (str[i] == '=') i++;
+	if (i < len && _san_piecetype(str[i]) != EMPTY && _san_piecetype(str[i]) != KING)
+	{
+	    san->promotion = _san_piecetype(str[i++]);
+	}
+	else if (str[i - 1] == '=')
+	{
+	    return false;
+	}
+    }
+    return _san_parse_suffix(str + i, len - i, san);
+}
+
+/*
+san_disambiguate sets the from-square hints for a move from "from",
+given the from squares of the other legal moves by the same piece type
+to the same square ("rivals", one bit per chessboard_square).  The file
+is given if it tells the moves apart, then the rank, and both only if
+neither does on its own.  Pawns always get their file, which san_format
+only writes for captures.
+ */
+void san_disambiguate(struct san_move* san, chessboard_square from, uint64_t rivals)
+{
+    const uint64_t file_a = 0x0101010101010101ULL;
+    const uint64_t rank_8 = 0xFFULL;
+    int file = from % 8, rank = from / 8;
+
+    san->from_file = -1;
+    san->from_rank = -1;
+    if (san->piece == PAWN)
+    {
+	san->from_file = file;
+    }
+    else if (rivals)
+    {
+	bool file_shared = rivals & (file_a << file);
+	bool rank_shared = rivals & (rank_8 << (8 * rank));
+	if (!file_shared || rank_shared) san->from_file = file;
+	if (file_shared) san->from_rank = rank;
+    }
+}
+
+void san_format(struct san_move* san, char* str)
+{
+    char* p = str;
+    if (san->castle != SAN_NO_CASTLE)
+    {
+	*p++ = 'O';
+	*p++ = '-';
+	*p++ = 'O';
+	if (san->castle == SAN_CASTLE_LONG)
+	{
+	    *p++ = '-';
+	    *p++ = 'O';
+	}
+    }
+    else
+    {
+	if (san->piece != PAWN) *p++ = san_piece_chars[san->piece];
+	if (san->from_file >= 0 && (san->piece != PAWN || san->capture)) *p++ = 'a' + san->from_file;
+	if (san->from_rank >= 0) *p++ = '8' - san->from_rank;
+	if (san->capture) *p++ = 'x';
+	*p++ = 'a' + san->to % 8;
+	*p++ = '8' - san->to / 8;
+	if (san->promotion != EMPTY)
+	{
+	    *p++ = '=';
+	    *p++ = san_piece_chars[san->promotion];
+	}
+    }
+    if (san->check == SAN_CHECK) *p++ = '+';
+    else if (san->check == SAN_MATE) *p++ = '#';
+    *p = '\0';
+}
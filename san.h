@@ -0,0 +1,53 @@
+#ifndef SAN_H
+#define SAN_H
+
+#include "chessboard_api.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Standard algebraic notation, shared by all of the board representations.
+san_parse reads a move like "Nbxd7+", "exd8=Q" or "O-O-O" in a single
+pass over a length-delimited span, without copying it or needing a null
+terminator, so moves can be parsed straight out of a PGN buffer.  It
+only works out what the text says.  Each representation then finds the
+one legal move that matches (see cb88_find_san_move and
+bb_find_san_move), which is also how ambiguous moves are caught.
+
+Squares are chessboard_squares.  from_file and from_rank are the hints
+given for the from square (0-7 with file 0 = a and rank 0 = 8, like the
+square numbering), or -1 if not given.  Pawn moves always have a file
+hint, since a pawn that doesn't capture stays on its file.  promotion
+is EMPTY unless the text names a promotion piece.
+
+san_format goes the other way and writes a move out as text, which
+takes at most CHESSBOARD_MAX_SAN characters (with the null).  The
+backends fill in the san_move from their own move and legal moves,
+using san_disambiguate to pick the shortest from-square hint.
+ */
+
+enum san_castle {
+    SAN_NO_CASTLE, SAN_CASTLE_SHORT, SAN_CASTLE_LONG,
+};
+
+enum san_check {
+    SAN_NO_CHECK, SAN_CHECK, SAN_MATE,
+};
+
+struct san_move {
+    chessboard_piecetype piece;
+    chessboard_square to;
+    int8_t from_file;
+    int8_t from_rank;
+    chessboard_piecetype promotion;
+    enum san_castle castle;
+    bool capture;
+    enum san_check check;
+};
+
+bool san_parse(const char* str, size_t len, struct san_move* san);
+void san_disambiguate(struct san_move* san, chessboard_square from, uint64_t rivals);
+void san_format(struct san_move* san, char* str);
+
+#endif
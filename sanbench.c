@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chessboard_api.h"
+
+/*
+SAN benchmark
+-----------------------------------------------------------------------
+Checks chessboard_move_to_san against some moves with known notation,
+then checks that every legal move in a handful of positions comes out
+as notation that chessboard_algmove reads back, and times writing them.
+Usage:
+
+    sanbench.exe [iterations]
+
+Only the chessboard API is used here, so the same driver can be linked
+against any board representation.
+ */
+
+struct san_test {
+    const char* fen;
+    chessboard_square from;
+    chessboard_square to;
+    chessboard_piecetype promotion;
+    // NULL if the move is illegal
+    const char* san;
+};
+
+const struct san_test san_tests[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", G1, F3, EMPTY, "Nf3"},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", E2, E4, EMPTY, "e4"},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", E2, E5, EMPTY, NULL},
+    {"4k3/8/8/8/8/8/8/1N2KN2 w - - 0 1", B1, D2, EMPTY, "Nbd2"},
+    {"4k3/8/8/R7/8/8/8/R3K3 w - - 0 1", A1, A3, EMPTY, "R1a3"},
+    {"8/8/k7/8/4Q2Q/8/8/K6Q w - - 0 1", H4, E1, EMPTY, "Qh4e1"},
+    {"4r2k/8/8/7N/8/8/4N3/4K3 w - - 0 1", H5, G3, EMPTY, "Ng3"},
+    {"4r2k/8/8/7N/8/8/4N3/4K3 w - - 0 1", E2, G3, EMPTY, NULL},
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", E5, D6, EMPTY, "exd6"},
+    {"4k3/8/8/3p4/8/8/8/3QK3 w - - 0 1", D1, D5, EMPTY, "Qxd5"},
+    {"k7/4P3/1K6/8/8/8/8/8 w - - 0 1", E7, E8, QUEEN, "e8=Q#"},
+    {"k7/4P3/1K6/8/8/8/8/8 w - - 0 1", E7, E8, EMPTY, NULL},
+    {"1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1", A7, B8, KNIGHT, "axb8=N"},
+    {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", E1, G1, EMPTY, "O-O+"},
+    {"r3k3/8/8/8/8/8/8/4K3 b q - 0 1", E8, C8, EMPTY, "O-O-O"},
+    {"4k3/8/8/8/8/8/4N3/4R1K1 w - - 0 1", E2, C3, EMPTY, "Nc3+"},
+    {"r5k1/8/8/8/8/8/5PPP/6K1 b - - 0 1", A8, A1, EMPTY, "Ra1#"},
+};
+#define NUM_SAN_TESTS (int)(sizeof(san_tests) / sizeof(san_tests[0]))
+
+const char* test_fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+#define NUM_TEST_FENS (int)(sizeof(test_fens) / sizeof(test_fens[0]))
+
+double _elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Checks that every legal move's notation reads back as a legal move,
+// and that mate is only claimed when the other side has no moves.
+int _check_round_trips(chessboard* cb, const char* fen)
+{
+    chessboard_movespec moves[CHESSBOARD_MAX_MOVES];
+    uint64_t counts[CHESSBOARD_MAX_MOVES];
+    char san[CHESSBOARD_MAX_SAN];
+    int failures = 0;
+
+    chessboard_set_fen(cb, fen);
+    int num_moves = chessboard_divide(cb, 1, moves, counts);
+    for (int i = 0; i < num_moves; i++)
+    {
+	chessboard_set_fen(cb, fen);
+	if (!chessboard_move_to_san(cb, moves[i], san))
+	{
+	    printf("No notation for move %d in %s\n", i, fen);
+	    failures++;
+	    continue;
+	}
+	if (!chessboard_algmove(cb, san))
+	{
+	    printf("%s doesn't read back in %s\n", san, fen);
+	    failures++;
+	    continue;
+	}
+	chessboard_switch_current_player(cb);
+	char suffix = san[strlen(san) - 1];
+	uint64_t replies = chessboard_perft(cb, 1);
+	if ((suffix == '#' && replies) || (suffix == '+' && !replies))
+	{
+	    printf("%s has the wrong check sign in %s\n", san, fen);
+	    failures++;
+	}
+    }
+    return failures;
+}
+
+int main(int argc, char* argv[])
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 100000;
+    chessboard_movespec moves[NUM_TEST_FENS][CHESSBOARD_MAX_MOVES];
+    int num_moves[NUM_TEST_FENS];
+    uint64_t counts[CHESSBOARD_MAX_MOVES];
+    char san[CHESSBOARD_MAX_SAN];
+    struct timespec start;
+    int failures = 0;
+
+    chessboard* cb = chessboard_allocate();
+    if (!cb)
+    {
+	printf("DEBUG: Failed to allocate board\n");
+	return -2;
+    }
+
+    for (int i = 0; i < NUM_SAN_TESTS; i++)
+    {
+	const struct san_test* test = &san_tests[i];
+	chessboard_movespec move = {test->from, test->to, test->promotion};
+	chessboard_set_fen(cb, test->fen);
+	bool legal = chessboard_move_to_san(cb, move, san);
+	if (legal != (test->san != NULL) || (legal && strcmp(san, test->san)))
+	{
+	    printf("Expected %s but got %s in %s\n", test->san ? test->san : "no move",
+		   legal ? san : "no move", test->fen);
+	    failures++;
+	}
+    }
+    for (int i = 0; i < NUM_TEST_FENS; i++)
+    {
+	failures += _check_round_trips(cb, test_fens[i]);
+    }
+    if (failures) return -1;
+
+    long total = 0;
+    for (int i = 0; i < NUM_TEST_FENS; i++)
+    {
+	chessboard_set_fen(cb, test_fens[i]);
+	num_moves[i] = chessboard_divide(cb, 1, moves[i], counts);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long n = 0; n < iterations; n++)
+    {
+	int i = n % NUM_TEST_FENS;
+	chessboard_set_fen(cb, test_fens[i]);
+	for (int j = 0; j < num_moves[i]; j++)
+	{
+	    chessboard_move_to_san(cb, moves[i][j], san);
+	}
+	total += num_moves[i];
+    }
+    double seconds = _elapsed_seconds(&start);
+    printf("move_to_san: %ld moves, %.3f s, %.0f per second\n", total, seconds,
+	   seconds > 0 ? (double)total / seconds : 0.0);
+
+    chessboard_free(cb);
+    return 0;
+}
@@ -0,0 +1,618 @@
+#include "search.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+The search itself is a plain fail-hard negamax: every node tries its
+moves best-looking first and returns as soon as one of them refutes the
+opponent's last move.  The moves come from a staged picker (see
+search.h), and each is checked for legality (against the node's
+check_info, without playing it) only when its turn comes, so a node
+that gets a cutoff early never pays for the moves it didn't try.
+
+At depth 0 the search doesn't stop dead, but carries on with a
+quiescence search of captures and promotions only, until the position
+is quiet enough for the static evaluation to mean something.  There
+the player to move may always "stand pat" on the evaluation instead of
+capturing, and captures that lose material by static exchange
+evaluation (cb88_see) aren't searched at all.  Checks aren't treated
+specially, so a mate at the horizon can be missed.
+
+Repetitions of a position on the current line and the fifty move rule
+are scored as draws.  Positions from before the root don't count, since
+the board doesn't remember them.
+ */
+
+const int piece_values[CHESSBOARD_MAX_PIECETYPE] = {0, 100, 320, 0, 330, 900, 500};
+const char search_piece_chars[CHESSBOARD_MAX_PIECETYPE] = {' ', 'p', 'n', 'k', 'b', 'q', 'r'};
+
+// How many nodes to search between checks of the clock.
+#define SEARCH_CHECK_INTERVAL 1024
+
+double _search_elapsed_seconds(struct timespec* start);
+uint64_t _search_total_nodes(struct search_shared* shared);
+bool _search_out_of_budget(struct search_shared* shared);
+bool _search_enter_node(struct search_context* ctx);
+void _search_worker(struct search_context* ctx);
+void* _search_thread_main(void* arg);
+bool _search_same_move(struct _move* a, struct _move* b);
+bool _search_is_quiet(chessboard* cb, struct _move* move);
+void _search_score_captures(chessboard* cb, struct move_list* list, int* scores);
+void _search_score_quiets(struct search_context* ctx, struct move_list* list, int* scores);
+struct _move* _search_pick_move(struct search_picker* picker);
+bool _search_picker_skip(struct search_picker* picker, struct _move* move);
+void _search_update_quiet(struct search_context* ctx, int depth, int ply, struct _move* move);
+int _search_score_to_tt(int score, int ply);
+int _search_score_from_tt(int score, int ply);
+void _search_report(struct search_result* result);
+
+double _search_elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+uint64_t _search_total_nodes(struct search_shared* shared)
+{
+    uint64_t nodes = 0;
+    for (int i = 0; i < shared->num_threads; i++)
+    {
+	nodes += __atomic_load_n(&shared->threads[i].nodes, __ATOMIC_RELAXED);
+    }
+    return nodes;
+}
+
+bool _search_out_of_budget(struct search_shared* shared)
+{
+    struct search_limits* limits = &shared->limits;
+    if (limits->stop && __atomic_load_n(limits->stop, __ATOMIC_RELAXED)) return true;
+    if (limits->nodes && _search_total_nodes(shared) >= limits->nodes) return true;
+    if (limits->seconds > 0 && _search_elapsed_seconds(&shared->start) >= limits->seconds) return true;
+    return false;
+}
+
+/*
+Counts a node, and returns false if the search has been told to stop.
+Only the main thread checks the limits, and only every so often.
+ */
+bool _search_enter_node(struct search_context* ctx)
+{
+    if (ctx->index == 0 && ctx->can_stop && ctx->nodes % SEARCH_CHECK_INTERVAL == 0 &&
+	_search_out_of_budget(ctx->shared))
+    {
+	__atomic_store_n(&ctx->shared->stop, true, __ATOMIC_RELAXED);
+    }
+    if (ctx->stop || __atomic_load_n(&ctx->shared->stop, __ATOMIC_RELAXED))
+    {
+	ctx->stop = true;
+	return false;
+    }
+    __atomic_store_n(&ctx->nodes, ctx->nodes + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+bool _search_same_move(struct _move* a, struct _move* b)
+{
+    return a->from == b->from && a->to == b->to && a->promotion == b->promotion;
+}
+
+uint16_t search_tt_move(struct _move* move)
+{
+    return TT_MOVE(cb88_get_chessboard_square(move->from),
+		   cb88_get_chessboard_square(move->to),
+		   move->promotion);
+}
+
+// Writes a move in coordinate notation, like e2e4 or e7e8q.
+void search_move_to_str(struct _move* move, char* str)
+{
+    str[0] = 'a' + cb88_get_file(move->from);
+    str[1] = '8' - cb88_get_rank(move->from);
+    str[2] = 'a' + cb88_get_file(move->to);
+    str[3] = '8' - cb88_get_rank(move->to);
+    str[4] = search_piece_chars[move->promotion];
+    str[5] = '\0';
+    if (move->promotion == EMPTY) str[4] = '\0';
+}
+
+/*
+search_evaluate scores the position for the player to move.  The board
+keeps the evaluation up to date as moves are made (see eval_0x88.h), so
+this is cheap enough to call at every leaf.
+ */
+int search_evaluate(chessboard* cb)
+{
+    return cb88_evaluate(cb);
+}
+
+// Quiet moves are the ones cb88_generate_quiets makes.
+bool _search_is_quiet(chessboard* cb, struct _move* move)
+{
+    return cb->board[move->to] == CB88_NO_PIECE && !move->is_en_passant &&
+	move->promotion == EMPTY;
+}
+
+// MVV-LVA: the victim's value decides, and the attacker's type breaks ties.
+void _search_score_captures(chessboard* cb, struct move_list* list, int* scores)
+{
+    for (int i = 0; i < list->count; i++)
+    {
+	struct _move* move = &list->moves[i];
+	struct piece* victim = move->is_en_passant ?
+	    CB88_PIECE_AT(cb, (move->from & 0x70) | (move->to & 0x07)) : CB88_PIECE_AT(cb, move->to);
+	int victim_value = victim ? piece_values[victim->type] : 0;
+	scores[i] = 16 * (victim_value + piece_values[move->promotion]) -
+	    CB88_PIECE_AT(cb, move->from)->type;
+    }
+}
+
+void _search_score_quiets(struct search_context* ctx, struct move_list* list, int* scores)
+{
+    int32_t (*history)[CHESSBOARD_MAX_SQUARE] = ctx->history[ctx->cb->to_move];
+    for (int i = 0; i < list->count; i++)
+    {
+	struct _move* move = &list->moves[i];
+	scores[i] = history[cb88_get_chessboard_square(move->from)][cb88_get_chessboard_square(move->to)];
+    }
+}
+
+// Hands out the best scoring move left in the picker's list, moving it
+// to the front of what's left.  Returns null when the list is used up.
+struct _move* _search_pick_move(struct search_picker* picker)
+{
+    struct move_list* list = &picker->list;
+    int* scores = picker->scores;
+    int first = picker->next;
+    if (first >= list->count) return NULL;
+
+    int best = first;
+    for (int i = first + 1; i < list->count; i++)
+    {
+	if (scores[i] > scores[best]) best = i;
+    }
+    if (best != first)
+    {
+	struct _move move = list->moves[first];
+	int score = scores[first];
+	list->moves[first] = list->moves[best];
+	scores[first] = scores[best];
+	list->moves[best] = move;
+	scores[best] = score;
+    }
+    picker->next++;
+    return &list->moves[first];
+}
+
+// True if the move was already handed out by an earlier stage.
+bool _search_picker_skip(struct search_picker* picker, struct _move* move)
+{
+    if (picker->has_hash_move && _search_same_move(move, &picker->hash_move)) return true;
+    if (picker->stage != SEARCH_STAGE_QUIETS) return false;
+    for (int i = 0; i < picker->num_killers; i++)
+    {
+	if (_search_same_move(move, &picker->killers[i])) return true;
+    }
+    return false;
+}
+
+/*
+hint may be any move at all (or null): it is only tried if the piece on
+its from square can make it.
+ */
+void search_picker_init(struct search_picker* picker, struct search_context* ctx, int ply,
+			struct _move* hint)
+{
+    chessboard* cb = ctx->cb;
+    picker->stage = SEARCH_STAGE_HASH;
+    picker->has_hash_move = false;
+    if (hint)
+    {
+	picker->hash_move = (struct _move){.from=hint->from, .to=hint->to, .promotion=hint->promotion};
+	picker->has_hash_move = cb88_find_pseudo_move(cb, &picker->hash_move);
+    }
+
+    // Killers are kept only if they are still quiet moves here.
+    picker->num_killers = 0;
+    picker->next_killer = 0;
+    for (int i = 0; i < SEARCH_KILLERS; i++)
+    {
+	struct _move* killer = &ctx->killers[ply][i];
+	struct _move* slot = &picker->killers[picker->num_killers];
+	if (killer->from == killer->to) continue;
+	*slot = (struct _move){.from=killer->from, .to=killer->to};
+	if (cb88_find_pseudo_move(cb, slot) && _search_is_quiet(cb, slot) &&
+	    !(picker->has_hash_move && _search_same_move(slot, &picker->hash_move)))
+	{
+	    picker->num_killers++;
+	}
+    }
+}
+
+struct _move* search_picker_next(struct search_picker* picker, struct search_context* ctx)
+{
+    struct _move* move;
+    switch (picker->stage)
+    {
+    case SEARCH_STAGE_HASH:
+	picker->stage = SEARCH_STAGE_GEN_CAPTURES;
+	if (picker->has_hash_move) return &picker->hash_move;
+	// fall through
+    case SEARCH_STAGE_GEN_CAPTURES:
+	cb88_generate_captures(ctx->cb, &picker->list);
+	_search_score_captures(ctx->cb, &picker->list, picker->scores);
+	picker->next = 0;
+	picker->stage = SEARCH_STAGE_CAPTURES;
+	// fall through
+    case SEARCH_STAGE_CAPTURES:
+	while ((move = _search_pick_move(picker)))
+	{
+	    if (!_search_picker_skip(picker, move)) return move;
+	}
+	picker->stage = SEARCH_STAGE_KILLERS;
+	// fall through
+    case SEARCH_STAGE_KILLERS:
+	if (picker->next_killer < picker->num_killers)
+	{
+	    return &picker->killers[picker->next_killer++];
+	}
+	picker->stage = SEARCH_STAGE_GEN_QUIETS;
+	// fall through
+    case SEARCH_STAGE_GEN_QUIETS:
+	cb88_generate_quiets(ctx->cb, &picker->list);
+	_search_score_quiets(ctx, &picker->list, picker->scores);
+	picker->next = 0;
+	picker->stage = SEARCH_STAGE_QUIETS;
+	// fall through
+    case SEARCH_STAGE_QUIETS:
+	while ((move = _search_pick_move(picker)))
+	{
+	    if (!_search_picker_skip(picker, move)) return move;
+	}
+	picker->stage = SEARCH_STAGE_DONE;
+	// fall through
+    default:
+	return NULL;
+    }
+}
+
+// A quiet move caused a cutoff: make it a killer and raise its history.
+void _search_update_quiet(struct search_context* ctx, int depth, int ply, struct _move* move)
+{
+    struct _move* killers = ctx->killers[ply];
+    if (!_search_same_move(move, &killers[0]))
+    {
+	for (int i = SEARCH_KILLERS - 1; i > 0; i--) killers[i] = killers[i - 1];
+	killers[0] = *move;
+    }
+
+    int32_t (*history)[CHESSBOARD_MAX_SQUARE][CHESSBOARD_MAX_SQUARE] = ctx->history;
+    chessboard_color color = ctx->cb->to_move;
+    int32_t* entry = &history[color][cb88_get_chessboard_square(move->from)]
+	[cb88_get_chessboard_square(move->to)];
+    *entry += depth * depth;
+    if (*entry >= SEARCH_HISTORY_MAX)
+    {
+	for (int from = 0; from < CHESSBOARD_MAX_SQUARE; from++)
+	{
+	    for (int to = 0; to < CHESSBOARD_MAX_SQUARE; to++) history[color][from][to] /= 2;
+	}
+    }
+}
+
+/*
+Mate scores count plies from the root, but an entry in the table can be
+reached from many roots, so the table stores them counting from the
+node instead.
+ */
+int _search_score_to_tt(int score, int ply)
+{
+    if (score >= SEARCH_MATE_BOUND) return score + ply;
+    if (score <= -SEARCH_MATE_BOUND) return score - ply;
+    return score;
+}
+
+int _search_score_from_tt(int score, int ply)
+{
+    if (score >= SEARCH_MATE_BOUND) return score - ply;
+    if (score <= -SEARCH_MATE_BOUND) return score + ply;
+    return score;
+}
+
+int search_quiesce(struct search_context* ctx, int ply, int alpha, int beta)
+{
+    chessboard* cb = ctx->cb;
+
+    ctx->pv_length[ply] = ply;
+    if (!_search_enter_node(ctx)) return 0;
+
+    int stand_pat = search_evaluate(cb);
+    if (stand_pat >= beta || ply >= SEARCH_MAX_PLY - 1) return stand_pat;
+    if (stand_pat > alpha) alpha = stand_pat;
+
+    struct search_picker picker;
+    struct undo_record undo;
+    struct check_info info;
+    struct _move* move;
+
+    cb88_get_check_info(cb, &info);
+    cb88_generate_captures(cb, &picker.list);
+    _search_score_captures(cb, &picker.list, picker.scores);
+    picker.next = 0;
+    picker.has_hash_move = false;
+    picker.stage = SEARCH_STAGE_CAPTURES;
+    while ((move = _search_pick_move(&picker)))
+    {
+	if (move->promotion == EMPTY && cb88_see(cb, move) < 0) continue;
+	if (!cb88_is_pseudo_move_legal(cb, &info, move)) continue;
+	cb88_make_move(cb, move, &undo);
+	int score = -search_quiesce(ctx, ply + 1, -beta, -alpha);
+	cb88_unmake_move(cb, move, &undo);
+	if (ctx->stop) return 0;
+
+	if (score > alpha)
+	{
+	    alpha = score;
+	    if (alpha >= beta) break;
+	}
+    }
+    return alpha;
+}
+
+int search_alphabeta(struct search_context* ctx, int depth, int ply, int alpha, int beta)
+{
+    chessboard* cb = ctx->cb;
+
+    if (depth <= 0) return search_quiesce(ctx, ply, alpha, beta);
+    ctx->pv_length[ply] = ply;
+    if (!_search_enter_node(ctx)) return 0;
+
+    if (ply > 0)
+    {
+	if (cb->halfmove_clock >= 100) return 0;
+	for (int i = ply - 2; i >= 0 && i >= ply - (int)cb->halfmove_clock; i -= 2)
+	{
+	    if (ctx->path[i] == cb->hash) return 0;
+	}
+    }
+    ctx->path[ply] = cb->hash;
+    if (ply >= SEARCH_MAX_PLY - 1) return search_evaluate(cb);
+
+    struct search_picker picker;
+    struct undo_record undo;
+    struct _move* hint = NULL;
+    struct _move tt_move;
+    struct tt_result entry;
+    struct ttable* tt = ctx->shared->tt;
+    bool tt_hit = tt && tt_probe(tt, cb->hash, &entry);
+
+    if (tt_hit && ply > 0 && entry.depth >= depth)
+    {
+	int score = _search_score_from_tt(entry.score, ply);
+	if (entry.bound == TT_BOUND_EXACT ||
+	    (entry.bound == TT_BOUND_LOWER && score >= beta) ||
+	    (entry.bound == TT_BOUND_UPPER && score <= alpha))
+	{
+	    return score;
+	}
+    }
+
+    // The previous iteration's PV comes first while we are still on it,
+    // and otherwise the table's best move.
+    if (ctx->follow_pv && ply < ctx->prev_pv_length)
+    {
+	hint = &ctx->prev_pv[ply];
+    }
+    else if (tt_hit && entry.move != TT_NO_MOVE)
+    {
+	tt_move = (struct _move){.from=cb88_get_square(TT_MOVE_FROM(entry.move)),
+				 .to=cb88_get_square(TT_MOVE_TO(entry.move)),
+				 .promotion=TT_MOVE_PROMOTION(entry.move)};
+	hint = &tt_move;
+    }
+    search_picker_init(&picker, ctx, ply, hint);
+    struct check_info info;
+    cb88_get_check_info(cb, &info);
+
+    int original_alpha = alpha;
+    int legal_moves = 0;
+    struct _move best_move;
+    bool has_best_move = false;
+    struct _move* move;
+    while ((move = search_picker_next(&picker, ctx)))
+    {
+	if (!cb88_is_pseudo_move_legal(cb, &info, move)) continue;
+	cb88_make_move(cb, move, &undo);
+	// The child probes the table first thing (unless it drops into the
+	// quiescence search), so start loading its bucket now.
+	if (tt && depth > 1) tt_prefetch(tt, cb->hash);
+	// Only the first move at each ply can still be on the old PV.
+	if (legal_moves++ > 0 || !hint || !_search_same_move(move, hint)) ctx->follow_pv = false;
+
+	int score = -search_alphabeta(ctx, depth - 1, ply + 1, -beta, -alpha);
+	cb88_unmake_move(cb, move, &undo);
+	if (ctx->stop) return 0;
+
+	if (score > alpha)
+	{
+	    alpha = score;
+	    best_move = *move;
+	    has_best_move = true;
+	    ctx->pv[ply][ply] = *move;
+	    for (int j = ply + 1; j < ctx->pv_length[ply + 1]; j++)
+	    {
+		ctx->pv[ply][j] = ctx->pv[ply + 1][j];
+	    }
+	    ctx->pv_length[ply] = ctx->pv_length[ply + 1];
+	    if (alpha >= beta)
+	    {
+		if (_search_is_quiet(cb, move)) _search_update_quiet(ctx, depth, ply, move);
+		break;
+	    }
+	}
+    }
+    if (legal_moves == 0)
+    {
+	return (info.num_checkers > 0) ? -SEARCH_MATE + ply : 0;
+    }
+
+    if (tt)
+    {
+	enum tt_bound bound = (alpha >= beta) ? TT_BOUND_LOWER :
+	    (alpha > original_alpha) ? TT_BOUND_EXACT : TT_BOUND_UPPER;
+	tt_store(tt, cb->hash, depth, bound, _search_score_to_tt(alpha, ply),
+		 has_best_move ? search_tt_move(&best_move) : TT_NO_MOVE);
+    }
+    return alpha;
+}
+
+void _search_report(struct search_result* result)
+{
+    char move_str[6];
+
+    printf("depth %d, score ", result->depth);
+    if (result->score >= SEARCH_MATE_BOUND)
+    {
+	printf("mate %d", (SEARCH_MATE - result->score + 1) / 2);
+    }
+    else if (result->score <= -SEARCH_MATE_BOUND)
+    {
+	printf("mate -%d", (SEARCH_MATE + result->score) / 2);
+    }
+    else
+    {
+	printf("%d", result->score);
+    }
+    printf(", %llu nodes, %.3f s", (unsigned long long)result->nodes, result->seconds);
+    if (result->seconds > 0) printf(", %.0f nps", (double)result->nodes / result->seconds);
+    printf(", pv");
+    for (int i = 0; i < result->pv_length; i++)
+    {
+	search_move_to_str(&result->pv[i], move_str);
+	printf(" %s", move_str);
+    }
+    printf("\n");
+}
+
+/*
+Helper threads skip some depths, following the pattern from Stockfish:
+helper i searches depth d unless ((d + skip_phase[i]) / skip_size[i]) is
+odd.  That spreads the helpers over the next few depths instead of
+having them all search the same one as the main thread.
+ */
+#define SEARCH_SKIP_PATTERNS 20
+const int skip_size[SEARCH_SKIP_PATTERNS] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int skip_phase[SEARCH_SKIP_PATTERNS] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+void _search_worker(struct search_context* ctx)
+{
+    struct search_shared* shared = ctx->shared;
+    struct search_result* result = &ctx->result;
+    int max_depth = (shared->limits.depth > 0 && shared->limits.depth < SEARCH_MAX_PLY) ?
+	shared->limits.depth : SEARCH_MAX_PLY - 1;
+
+    for (int depth = 1; depth <= max_depth; depth++)
+    {
+	if (ctx->index > 0)
+	{
+	    int pattern = (ctx->index - 1) % SEARCH_SKIP_PATTERNS;
+	    if (((depth + skip_phase[pattern]) / skip_size[pattern]) % 2) continue;
+	}
+
+	ctx->follow_pv = true;
+	int score = search_alphabeta(ctx, depth, 0, -SEARCH_INFINITY, SEARCH_INFINITY);
+	// An unfinished iteration can't be trusted.
+	if (ctx->stop) break;
+
+	result->depth = depth;
+	result->score = score;
+	result->pv_length = ctx->pv_length[0];
+	memcpy(result->pv, ctx->pv[0], sizeof(struct _move) * result->pv_length);
+	memcpy(ctx->prev_pv, ctx->pv[0], sizeof(struct _move) * result->pv_length);
+	ctx->prev_pv_length = result->pv_length;
+	ctx->can_stop = true;
+	if (ctx->index > 0) continue;
+
+	result->nodes = _search_total_nodes(shared);
+	result->seconds = _search_elapsed_seconds(&shared->start);
+	if (ctx->report) _search_report(result);
+	if (shared->limits.on_iteration) shared->limits.on_iteration(result, shared->limits.data);
+	if (result->pv_length == 0) break;
+	if ((score >= SEARCH_MATE_BOUND || score <= -SEARCH_MATE_BOUND) &&
+	    SEARCH_MATE - (score > 0 ? score : -score) <= depth)
+	{
+	    break;
+	}
+	if (_search_out_of_budget(shared)) break;
+    }
+
+    // When the main thread is done, so is everyone else.
+    if (ctx->index == 0) __atomic_store_n(&shared->stop, true, __ATOMIC_RELAXED);
+}
+
+void* _search_thread_main(void* arg)
+{
+    _search_worker((struct search_context *)arg);
+    return NULL;
+}
+
+void search_iterate(chessboard* cb, struct ttable* tt, struct search_limits* limits,
+		    int num_threads, bool report, struct search_result* result)
+{
+    struct search_shared shared = (struct search_shared){.tt=tt,
+							 .limits=*limits,
+							 .num_threads=1};
+
+    *result = (struct search_result){0};
+    if (num_threads < 1) num_threads = 1;
+    shared.threads = (struct search_context *)calloc(num_threads, sizeof(struct search_context));
+    if (!shared.threads)
+    {
+	printf("DEBUG: Failed to allocate search threads\n");
+	return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &shared.start);
+    if (tt) tt_new_search(tt);
+
+    // The main thread searches cb itself.  Each helper gets a copy, out
+    // of an arena so that no two threads' boards share a cache line.
+    shared.threads[0] = (struct search_context){.shared=&shared,
+						.cb=cb,
+						.report=report};
+    chessboard_arena* arena = (num_threads > 1) ? chessboard_arena_allocate(num_threads - 1) : NULL;
+    for (int i = 1; i < num_threads && arena; i++)
+    {
+	struct search_context* ctx = &shared.threads[i];
+	*ctx = (struct search_context){.shared=&shared,
+				       .index=i};
+	if (!chessboard_allocate_many(arena, 1, &ctx->cb)) break;
+	cb88_copy_board(ctx->cb, cb);
+	if (pthread_create(&ctx->thread, NULL, _search_thread_main, ctx))
+	{
+	    printf("DEBUG: Failed to start search thread %d\n", i);
+	    break;
+	}
+	shared.num_threads = i + 1;
+    }
+
+    _search_worker(&shared.threads[0]);
+
+    *result = shared.threads[0].result;
+    for (int i = 1; i < shared.num_threads; i++)
+    {
+	struct search_context* ctx = &shared.threads[i];
+	pthread_join(ctx->thread, NULL);
+	if (ctx->result.depth > result->depth && ctx->result.pv_length > 0)
+	{
+	    *result = ctx->result;
+	}
+    }
+    if (arena) chessboard_arena_free(arena);
+    result->nodes = _search_total_nodes(&shared);
+    result->seconds = _search_elapsed_seconds(&shared.start);
+    free(shared.threads);
+}
@@ -0,0 +1,195 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "chessboard_api.h"
+#include "chessboard_0x88.h"
+#include "move_0x88.h"
+#include "movegen_0x88.h"
+#include "ttable.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+Search
+-----------------------------------------------------------------------
+A negamax alpha-beta search over the 0x88 board, driven by iterative
+deepening: we search to depth 1, 2, 3, ... until we run out of depth,
+nodes or time, and keep the result of the last completed iteration.
+Each iteration starts with the principal variation of the one before,
+and (if a transposition table is given) with the best moves the table
+remembers, which is what makes the repeated searches cheap.
+
+Scores are in centipawns from the point of view of the player to move.
+Mate scores are SEARCH_MATE minus the number of plies to the mate, so
+anything beyond SEARCH_MATE_BOUND in either direction is a forced mate.
+ */
+
+#define SEARCH_MAX_PLY 64
+#define SEARCH_INFINITY 32000
+#define SEARCH_MATE 31000
+#define SEARCH_MATE_BOUND (SEARCH_MATE - SEARCH_MAX_PLY)
+
+/*
+A zero in any limit means no limit of that kind.  With no limits at all
+the search stops at SEARCH_MAX_PLY.  The node and time limits are only
+checked every so often, so the search can overrun them slightly.  If
+"stop" isn't null, another thread can end the search early by setting
+*stop to true.
+
+If "on_iteration" isn't null, the main thread calls it with each
+iteration's result as soon as the iteration completes (and while the
+board is back at the root), passing "data" along.  That is how a test
+suite runner sees when the search first settles on the right move.
+ */
+struct search_result;
+
+struct search_limits {
+    int depth;
+    uint64_t nodes;
+    double seconds;
+    bool* stop;
+    void (*on_iteration)(struct search_result* result, void* data);
+    void* data;
+};
+
+struct search_result {
+    struct _move pv[SEARCH_MAX_PLY];
+    int pv_length;
+    int score;
+    // Depth of the last completed iteration, 0 if none completed.
+    int depth;
+    uint64_t nodes;
+    double seconds;
+};
+
+/*
+Moves are handed to the search by a staged picker, one at a time, so
+that a node which gets a cutoff early never generates the rest:
+
+1. The hash move (the previous PV's move or the table's best move)
+2. Captures and promotions, most valuable victim and least valuable
+   attacker first (MVV-LVA)
+3. The killer moves for this ply
+4. Quiet moves, in order of their history scores
+
+Moves that come from the table or the killers are checked against the
+position before they are tried, and are skipped in the later stages.
+The picker hands out pseudo-legal moves; the search checks each one
+against the node's check_info (see movegen_0x88.h) before playing it.
+ */
+enum search_stage {
+    SEARCH_STAGE_HASH,
+    SEARCH_STAGE_GEN_CAPTURES,
+    SEARCH_STAGE_CAPTURES,
+    SEARCH_STAGE_KILLERS,
+    SEARCH_STAGE_GEN_QUIETS,
+    SEARCH_STAGE_QUIETS,
+    SEARCH_STAGE_DONE,
+};
+
+#define SEARCH_KILLERS 2
+// History scores are halved when one reaches this, so that recent
+// cutoffs count for more than old ones.
+#define SEARCH_HISTORY_MAX (1 << 20)
+
+struct search_picker {
+    enum search_stage stage;
+    // Only valid if has_hash_move is set.
+    struct _move hash_move;
+    bool has_hash_move;
+    struct _move killers[SEARCH_KILLERS];
+    int num_killers;
+    int next_killer;
+    // Captures, then quiets, and their scores.
+    struct move_list list;
+    int scores[CB88_MAX_MOVES];
+    int next;
+};
+
+struct search_shared;
+
+/*
+Everything one search thread owns.  Each thread searches its own copy
+of the board, and keeps its undo records on its own stack, so the only
+things threads share are the transposition table and the stop flag.
+ */
+struct search_context {
+    struct search_shared* shared;
+    int index;
+    pthread_t thread;
+    chessboard* cb;
+    // Print a line for each completed iteration.
+    bool report;
+
+    // Written only by the owning thread, but read by the main thread to
+    // total up the nodes searched.
+    uint64_t nodes;
+    // Set once this thread has seen the shared stop flag.
+    bool stop;
+    // False until depth 1 is done, so there is always a move to play.
+    bool can_stop;
+    // The last iteration this thread completed.
+    struct search_result result;
+
+    // The PV of the last completed iteration, which is searched first
+    // for as long as the search is still following it.
+    struct _move prev_pv[SEARCH_MAX_PLY];
+    int prev_pv_length;
+    bool follow_pv;
+
+    // Triangular PV table: pv[ply] holds the best line found from ply.
+    struct _move pv[SEARCH_MAX_PLY][SEARCH_MAX_PLY];
+    int pv_length[SEARCH_MAX_PLY];
+    // Hashes of the positions on the current line, for repetitions.
+    uint64_t path[SEARCH_MAX_PLY];
+
+    // Quiet moves that caused cutoffs at each ply, newest first.
+    struct _move killers[SEARCH_MAX_PLY][SEARCH_KILLERS];
+    // How much each quiet move, by color and API from and to squares,
+    // has caused cutoffs in this search.
+    int32_t history[CHESSBOARD_MAX_COLOR][CHESSBOARD_MAX_SQUARE][CHESSBOARD_MAX_SQUARE];
+};
+
+struct search_shared {
+    // May be null, in which case nothing is remembered between nodes
+    // (and extra threads just repeat the main thread's work).
+    struct ttable* tt;
+    struct search_limits limits;
+    struct timespec start;
+    // Set by the main thread when the search is over.  Every thread
+    // polls it at every node.
+    bool stop;
+    int num_threads;
+    struct search_context* threads;
+};
+
+/*
+search_iterate searches the position on cb within the given limits and
+fills in result.  cb is left as it was found.  If the side to move has
+no legal moves, result->pv_length is 0.
+
+With num_threads > 1 this is a "lazy SMP" search: the calling thread and
+num_threads - 1 helper threads all search the same position, sharing
+the transposition table.  The helpers skip some depths so that they run
+ahead of the main thread and fill the table with results it can use.
+Only the main thread reports iterations and checks the limits, and the
+reported node counts are the total for all threads.  The result is the
+deepest completed iteration of any thread.
+ */
+void search_iterate(chessboard* cb, struct ttable* tt, struct search_limits* limits,
+		    int num_threads, bool report, struct search_result* result);
+
+int search_evaluate(chessboard* cb);
+int search_alphabeta(struct search_context* ctx, int depth, int ply, int alpha, int beta);
+int search_quiesce(struct search_context* ctx, int ply, int alpha, int beta);
+
+void search_picker_init(struct search_picker* picker, struct search_context* ctx, int ply,
+			struct _move* hint);
+struct _move* search_picker_next(struct search_picker* picker, struct search_context* ctx);
+
+uint16_t search_tt_move(struct _move* move);
+void search_move_to_str(struct _move* move, char* str);
+
+#endif
@@ -0,0 +1,161 @@
+#include "ttable.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+#include <stdio.h> //For debugging
+
+/*
+Layout of the data word of an entry:
+
+    bits  0-15  score (int16_t)
+    bits 16-31  best move (TT_MOVE)
+    bits 32-39  depth (int8_t)
+    bits 40-41  bound (enum tt_bound)
+    bits 48-55  generation
+
+Empty entries are all zeros, and a zero bound (TT_BOUND_NONE) is never
+reported as a hit, so a key of zero doesn't match an empty entry.
+
+The loads and stores go through the relaxed __atomic builtins.  They
+compile to plain 64-bit moves, but keep the compiler from tearing or
+caching them, since other threads may be writing the same words.
+ */
+
+uint64_t _tt_pack(int depth, enum tt_bound bound, int score, uint16_t move, uint8_t generation);
+int _tt_replacement_value(struct ttable* tt, uint64_t data);
+
+uint64_t _tt_pack(int depth, enum tt_bound bound, int score, uint16_t move, uint8_t generation)
+{
+    return (uint64_t)(uint16_t)(int16_t)score |
+	((uint64_t)move << 16) |
+	((uint64_t)(uint8_t)(int8_t)depth << 32) |
+	((uint64_t)(bound & 0x3) << 40) |
+	((uint64_t)generation << 48);
+}
+
+// Entries with lower values are replaced first: shallow entries, and
+// especially ones left over from earlier searches.
+int _tt_replacement_value(struct ttable* tt, uint64_t data)
+{
+    int depth = (int8_t)(data >> 32);
+    int age = (uint8_t)(tt->generation - (uint8_t)(data >> 48));
+    return depth - 8 * age;
+}
+
+struct ttable* tt_allocate(size_t megabytes)
+{
+    struct ttable* tt = (struct ttable *)malloc(sizeof(struct ttable));
+    if (!tt)
+    {
+	printf("DEBUG: Failed to allocate transposition table\n");
+	return NULL;
+    }
+
+    size_t buckets = 1;
+    while (buckets * 2 * sizeof(struct tt_bucket) <= megabytes * 1024 * 1024)
+    {
+	buckets *= 2;
+    }
+    tt->buckets = (struct tt_bucket *)aligned_alloc(sizeof(struct tt_bucket),
+						     buckets * sizeof(struct tt_bucket));
+    if (!tt->buckets)
+    {
+	printf("DEBUG: Failed to allocate %zu transposition table buckets\n", buckets);
+	free(tt);
+	return NULL;
+    }
+    tt->bucket_mask = buckets - 1;
+    tt_clear(tt);
+    return tt;
+}
+
+void tt_free(struct ttable* tt)
+{
+    assert(tt && "Tried to free null pointer to transposition table");
+    free(tt->buckets);
+    free(tt);
+}
+
+void tt_clear(struct ttable* tt)
+{
+    memset(tt->buckets, 0, tt_size_bytes(tt));
+    tt->generation = 0;
+}
+
+size_t tt_size_bytes(struct ttable* tt)
+{
+    return (size_t)(tt->bucket_mask + 1) * sizeof(struct tt_bucket);
+}
+
+void tt_new_search(struct ttable* tt)
+{
+    tt->generation++;
+}
+
+void tt_prefetch(struct ttable* tt, uint64_t key)
+{
+    __builtin_prefetch(&tt->buckets[key & tt->bucket_mask]);
+}
+
+bool tt_probe(struct ttable* tt, uint64_t key, struct tt_result* result)
+{
+    struct tt_entry* entries = tt->buckets[key & tt->bucket_mask].entries;
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++)
+    {
+	uint64_t check = __atomic_load_n(&entries[i].check, __ATOMIC_RELAXED);
+	uint64_t data = __atomic_load_n(&entries[i].data, __ATOMIC_RELAXED);
+	if ((check ^ data) == key && ((data >> 40) & 0x3) != TT_BOUND_NONE)
+	{
+	    result->score = (int16_t)(data & 0xFFFF);
+	    result->move = (uint16_t)(data >> 16);
+	    result->depth = (int8_t)(data >> 32);
+	    result->bound = (data >> 40) & 0x3;
+	    return true;
+	}
+    }
+    return false;
+}
+
+/*
+tt_store writes over the entry for the same key if there is one, and
+otherwise over the entry with the lowest replacement value.  An entry
+for the same key is kept if it came from a noticeably deeper search in
+the current generation, unless the new result is exact.  A new result
+without a best move keeps the old entry's move.
+ */
+void tt_store(struct ttable* tt, uint64_t key, int depth, enum tt_bound bound, int score, uint16_t move)
+{
+    struct tt_entry* entries = tt->buckets[key & tt->bucket_mask].entries;
+    struct tt_entry* replace = NULL;
+    int lowest_value = 0;
+
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++)
+    {
+	uint64_t check = __atomic_load_n(&entries[i].check, __ATOMIC_RELAXED);
+	uint64_t data = __atomic_load_n(&entries[i].data, __ATOMIC_RELAXED);
+	if ((check ^ data) == key)
+	{
+	    uint8_t generation = (uint8_t)(data >> 48);
+	    if (bound != TT_BOUND_EXACT && generation == tt->generation &&
+		(int8_t)(data >> 32) > depth + 2)
+	    {
+		return;
+	    }
+	    if (move == TT_NO_MOVE) move = (uint16_t)(data >> 16);
+	    replace = &entries[i];
+	    break;
+	}
+	int value = _tt_replacement_value(tt, data);
+	if (!replace || value < lowest_value)
+	{
+	    replace = &entries[i];
+	    lowest_value = value;
+	}
+    }
+
+    uint64_t data = _tt_pack(depth, bound, score, move, tt->generation);
+    __atomic_store_n(&replace->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&replace->check, key ^ data, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,92 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include "chessboard_api.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Transposition table
+-----------------------------------------------------------------------
+A fixed-size hash table of search results keyed by the Zobrist hash
+from chessboard_get_hash.  It doesn't look inside the board at all, so
+any representation (and any number of search threads) can share one.
+
+The table is an array of 64-byte buckets, one cache line each, holding
+four 16-byte entries.  The number of buckets is a power of two and the
+low bits of the key pick the bucket, so a probe touches one cache line.
+
+An entry is two 64-bit words: the packed data (score, best move, depth,
+bound and the search generation that stored it) and the key XORed with
+that data.  Threads read and write the words without locking.  If two
+threads write the same entry at once, a reader can see one thread's
+data with the other's check word, but then key ^ data no longer gives
+back the key being probed and the entry is treated as a miss.  This is
+the scheme from Hyatt and Mann's "lockless transposition tables".
+
+Best moves are stored as a 16-bit chessboard_movespec (TT_MOVE below)
+using API squares, and 0 means no move.  Scores are whatever the search
+stores; adjusting mate scores for the distance from the root is up to
+the caller.
+ */
+
+enum tt_bound {
+    TT_BOUND_NONE, TT_BOUND_UPPER, TT_BOUND_LOWER, TT_BOUND_EXACT,
+};
+
+#define TT_BUCKET_ENTRIES 4
+#define TT_NO_MOVE 0
+
+#define TT_MOVE(from, to, promotion) \
+    ((uint16_t)((from) | ((to) << 6) | ((promotion) << 12)))
+#define TT_MOVE_FROM(move) ((chessboard_square)((move) & 0x3F))
+#define TT_MOVE_TO(move) ((chessboard_square)(((move) >> 6) & 0x3F))
+#define TT_MOVE_PROMOTION(move) ((chessboard_piecetype)(((move) >> 12) & 0x7))
+
+struct tt_entry {
+    uint64_t check;
+    uint64_t data;
+};
+
+struct tt_bucket {
+    struct tt_entry entries[TT_BUCKET_ENTRIES];
+} __attribute__((aligned(64)));
+
+struct ttable {
+    struct tt_bucket* buckets;
+    uint64_t bucket_mask;
+    uint8_t generation;
+};
+
+// An unpacked entry, as returned by tt_probe.
+struct tt_result {
+    int16_t score;
+    uint16_t move;
+    int8_t depth;
+    uint8_t bound;
+};
+
+/*
+tt_allocate returns a cleared table of at most "megabytes" MB (rounded
+down to a power-of-two number of buckets, and at least one bucket), or
+a null pointer if allocation fails.  Free it with tt_free.
+ */
+struct ttable* tt_allocate(size_t megabytes);
+void tt_free(struct ttable* tt);
+void tt_clear(struct ttable* tt);
+size_t tt_size_bytes(struct ttable* tt);
+
+/*
+tt_new_search should be called once before each new search (not each
+iteration).  Entries from older searches are replaced first.
+ */
+void tt_new_search(struct ttable* tt);
+
+bool tt_probe(struct ttable* tt, uint64_t key, struct tt_result* result);
+void tt_store(struct ttable* tt, uint64_t key, int depth, enum tt_bound bound, int score, uint16_t move);
+
+// Hint to the processor to start loading the bucket for key.
+void tt_prefetch(struct ttable* tt, uint64_t key);
+
+#endif
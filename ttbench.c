@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "ttable.h"
+
+/*
+Transposition table benchmark
+-----------------------------------------------------------------------
+Measures store and probe throughput of the transposition table.  Usage:
+
+    ttbench.exe [megabytes [operations [threads]]]
+
+Each thread stores "operations" pseudo-random keys, then probes the same
+keys again (mostly hits, unless the table is too small to hold them)
+and then probes fresh keys (misses).  Every stored score and move is
+derived from its key, so a hit whose contents don't match its key means
+a torn write got through the XOR check.  That count should always be 0.
+ */
+
+struct bench_thread {
+    pthread_t thread;
+    struct ttable* tt;
+    uint64_t seed;
+    uint64_t operations;
+    uint64_t hits;
+    uint64_t false_hits;
+    uint64_t corrupt;
+};
+
+// Everything a thread does in one phase, so we can time the phases
+// separately with all threads running together.
+enum bench_phase {
+    PHASE_STORE, PHASE_PROBE_STORED, PHASE_PROBE_FRESH,
+};
+
+enum bench_phase current_phase;
+
+double _elapsed_seconds(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+	(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+uint64_t _next_key(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void* _bench_thread_main(void* arg)
+{
+    struct bench_thread* bt = (struct bench_thread *)arg;
+    uint64_t state = bt->seed;
+    struct tt_result result;
+
+    if (current_phase == PHASE_PROBE_FRESH) state = ~bt->seed;
+    for (uint64_t i = 0; i < bt->operations; i++)
+    {
+	uint64_t key = _next_key(&state);
+	int16_t score = (int16_t)(key >> 48);
+	uint16_t move = (uint16_t)(key >> 32) & 0x7FFF;
+	switch (current_phase)
+	{
+	case PHASE_STORE:
+	    tt_store(bt->tt, key, (int)(key & 0x3F), TT_BOUND_EXACT, score, move);
+	    break;
+	case PHASE_PROBE_STORED:
+	    if (tt_probe(bt->tt, key, &result))
+	    {
+		bt->hits++;
+		if (result.score != score || result.move != move) bt->corrupt++;
+	    }
+	    break;
+	case PHASE_PROBE_FRESH:
+	    if (tt_probe(bt->tt, key, &result)) bt->false_hits++;
+	    break;
+	}
+    }
+    return NULL;
+}
+
+void _run_phase(struct bench_thread* threads, int num_threads, enum bench_phase phase, const char* name)
+{
+    struct timespec start;
+    uint64_t total = 0;
+
+    current_phase = phase;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_threads; i++)
+    {
+	pthread_create(&threads[i].thread, NULL, _bench_thread_main, &threads[i]);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+	pthread_join(threads[i].thread, NULL);
+	total += threads[i].operations;
+    }
+    double seconds = _elapsed_seconds(&start);
+    printf("%-16s %llu ops, %.3f s, %.1f Mops/s\n", name, (unsigned long long)total,
+	   seconds, seconds > 0 ? (double)total / seconds / 1e6 : 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t megabytes = (argc > 1) ? (size_t)atoi(argv[1]) : 64;
+    uint64_t operations = (argc > 2) ? (uint64_t)atoll(argv[2]) : 10000000;
+    int num_threads = (argc > 3) ? atoi(argv[3]) : 1;
+    if (num_threads < 1 || operations < 1)
+    {
+	printf("Usage: %s [megabytes [operations [threads]]]\n", argv[0]);
+	return -1;
+    }
+
+    struct ttable* tt = tt_allocate(megabytes);
+    struct bench_thread* threads = (struct bench_thread *)calloc(num_threads, sizeof(struct bench_thread));
+    if (!tt || !threads)
+    {
+	printf("DEBUG: Failed to allocate benchmark\n");
+	return -2;
+    }
+    printf("Table: %zu bytes, %llu entries, %d thread(s)\n", tt_size_bytes(tt),
+	   (unsigned long long)(tt_size_bytes(tt) / sizeof(struct tt_entry)), num_threads);
+    for (int i = 0; i < num_threads; i++)
+    {
+	threads[i] = (struct bench_thread){.tt=tt,
+					   .seed=0x1234567ULL * (uint64_t)(i + 1),
+					   .operations=operations};
+    }
+
+    tt_new_search(tt);
+    _run_phase(threads, num_threads, PHASE_STORE, "store:");
+    _run_phase(threads, num_threads, PHASE_PROBE_STORED, "probe (stored):");
+    _run_phase(threads, num_threads, PHASE_PROBE_FRESH, "probe (fresh):");
+
+    uint64_t hits = 0, false_hits = 0, corrupt = 0;
+    for (int i = 0; i < num_threads; i++)
+    {
+	hits += threads[i].hits;
+	false_hits += threads[i].false_hits;
+	corrupt += threads[i].corrupt;
+    }
+    printf("\nHit rate: %.1f%%\nFalse hits: %llu\nCorrupt hits: %llu\n",
+	   100.0 * (double)hits / (double)(operations * num_threads),
+	   (unsigned long long)false_hits, (unsigned long long)corrupt);
+
+    free(threads);
+    tt_free(tt);
+    return 0;
+}
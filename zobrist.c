@@ -0,0 +1,59 @@
+#include "zobrist.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+uint64_t zobrist_pieces[2][CHESSBOARD_MAX_PIECETYPE][CHESSBOARD_MAX_SQUARE];
+uint64_t zobrist_castle[16];
+uint64_t zobrist_ep_file[8];
+uint64_t zobrist_black_to_move;
+
+pthread_once_t zobrist_once = PTHREAD_ONCE_INIT;
+
+uint64_t _zobrist_next(uint64_t* state);
+void _zobrist_fill();
+
+// splitmix64, which is plenty random for hash keys.
+uint64_t _zobrist_next(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void _zobrist_fill()
+{
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+
+    for (int color = WHITE; color < CHESSBOARD_MAX_COLOR; color++)
+    {
+	for (int type = EMPTY; type < CHESSBOARD_MAX_PIECETYPE; type++)
+	{
+	    for (int square = A8; square < CHESSBOARD_MAX_SQUARE; square++)
+	    {
+		// EMPTY squares don't contribute to the hash.
+		zobrist_pieces[color][type][square] = (type == EMPTY) ? 0 : _zobrist_next(&state);
+	    }
+	}
+    }
+    // Each castling right gets its own key, and a set of rights hashes
+    // to the XOR of its members, so changing one right is one XOR.
+    uint64_t rights[4];
+    for (int i = 0; i < 4; i++) rights[i] = _zobrist_next(&state);
+    for (int mask = 0; mask < 16; mask++)
+    {
+	zobrist_castle[mask] = 0;
+	for (int i = 0; i < 4; i++)
+	{
+	    if (mask & (1 << i)) zobrist_castle[mask] ^= rights[i];
+	}
+    }
+    for (int file = 0; file < 8; file++) zobrist_ep_file[file] = _zobrist_next(&state);
+    zobrist_black_to_move = _zobrist_next(&state);
+}
+
+void zobrist_init()
+{
+    pthread_once(&zobrist_once, _zobrist_fill);
+}
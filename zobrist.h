@@ -0,0 +1,35 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "chessboard_api.h"
+#include <stdint.h>
+
+/*
+Zobrist keys shared by all of the board representations.  A position's
+hash is the XOR of the key for each piece on its square, the key for
+the current castling rights, the key for the file of the en passant
+square (if there is one) and, if black is to move, zobrist_black_to_move.
+Since every representation uses the same keys, the same position hashes
+to the same value no matter which one computed it.  
+
+Castling rights are indexed as a mask with white short = 1, white long 
+= 2, black short = 4 and black long = 8.
+
+zobrist_init fills the keys from a fixed seed, so hashes are also the
+same from one run to the next.  It is safe to call more than once, and
+from several threads at once: the first call fills the keys, and any
+others wait until it is done.
+ */
+extern uint64_t zobrist_pieces[2][CHESSBOARD_MAX_PIECETYPE][CHESSBOARD_MAX_SQUARE];
+extern uint64_t zobrist_castle[16];
+extern uint64_t zobrist_ep_file[8];
+extern uint64_t zobrist_black_to_move;
+
+#define ZOBRIST_WHITE_SHORT 0x1
+#define ZOBRIST_WHITE_LONG 0x2
+#define ZOBRIST_BLACK_SHORT 0x4
+#define ZOBRIST_BLACK_LONG 0x8
+
+void zobrist_init();
+
+#endif